@@ -0,0 +1,116 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <numeric>
+#include <algorithm>
+
+#include "flat_interval_tree.h"
+
+enum class batch_strategy {
+    automatic, // sweep for batches large for the thread count, per-point otherwise
+    parallel,  // independent tree queries spread across threads
+    sweep      // offline sort-and-sweep over all endpoints
+};
+
+namespace batch_query {
+    /// 0 becomes the hardware concurrency
+    inline unsigned resolve_threads(unsigned threads) {
+        return threads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : threads;
+    }
+
+    /// calls work(begin, end) for contiguous chunks of [0, size) on up to threads threads
+    template <typename F>
+    void for_each_chunk(size_t size, unsigned threads, F work) {
+        size_t chunk = std::max<size_t>(1, (size + threads - 1) / threads);
+
+        std::vector<std::thread> workers;
+        for (size_t begin = 0; begin < size; begin += chunk)
+            workers.emplace_back(work, begin, std::min(size, begin + chunk));
+        for (auto &w: workers)
+            w.join();
+    }
+
+    template <typename T, typename P>
+    std::vector<int> parallel_queries(const flat_interval_view<T, P> &tree, const std::vector<T> &points,
+                                      unsigned threads) {
+        std::vector<int> result(points.size());
+        for_each_chunk(points.size(), resolve_threads(threads), [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i)
+                result[i] = tree.get_numb_of_intervals(points[i]);
+        });
+        return result;
+    }
+
+    /// Sweep over the sorted endpoints. The two endpoint sorts run side by side, then every thread sorts
+    /// its own chunk of the points and sweeps it from counts found by binary search at its smallest point,
+    /// so no step works through all of the points on one core.
+    template <typename T, typename P>
+    std::vector<int> sweep_queries(const flat_interval_view<T, P> &tree, const std::vector<T> &points,
+                                   unsigned threads) {
+        threads = resolve_threads(threads);
+
+        // the pools hold every start and every end exactly once
+        std::vector<T> starts(tree.starts, tree.starts + tree.center_count), ends(tree.ends, tree.ends + tree.center_count);
+        if (threads > 1) {
+            std::thread sort_starts([&starts]() { std::sort(starts.begin(), starts.end()); });
+            std::sort(ends.begin(), ends.end());
+            sort_starts.join();
+        } else {
+            std::sort(starts.begin(), starts.end());
+            std::sort(ends.begin(), ends.end());
+        }
+
+        // count(p) = #{start <= p} - #{end < p}
+        std::vector<int> result(points.size());
+        std::vector<size_t> order(points.size());
+        std::iota(order.begin(), order.end(), 0);
+        for_each_chunk(points.size(), threads, [&](size_t begin, size_t end) {
+            std::sort(order.begin() + begin, order.begin() + end,
+                      [&](size_t a, size_t b) { return points[a] < points[b]; });
+
+            const T &lowest = points[order[begin]];
+            size_t opened = std::upper_bound(starts.begin(), starts.end(), lowest) - starts.begin();
+            size_t closed = std::lower_bound(ends.begin(), ends.end(), lowest) - ends.begin();
+            for (size_t j = begin; j < end; ++j) {
+                size_t i = order[j];
+                const T &point = points[i];
+                while (opened < starts.size() && starts[opened] <= point)
+                    opened++;
+                while (closed < ends.size() && ends[closed] < point)
+                    closed++;
+                result[i] = (int)(opened - closed);
+            }
+        });
+
+        return result;
+    }
+}
+
+/// answers a batch of stabbing queries at once
+/// \param tree tree to query
+/// \param points query points in any order
+/// \param strategy how to evaluate the batch
+/// \param threads number of worker threads of either strategy, 0 - hardware concurrency
+/// \return number of intervals containing points[i] at position i
+template <typename T, typename P>
+std::vector<int> get_numb_of_intervals(const flat_interval_view<T, P> &tree, const std::vector<T> &points,
+                                       batch_strategy strategy = batch_strategy::automatic,
+                                       unsigned threads = 0) {
+    threads = batch_query::resolve_threads(threads);
+    if (strategy == batch_strategy::automatic) {
+        // both strategies spread the points over the same threads; the sweep adds the sort of the endpoints,
+        // which pays off once every thread's share of the batch is about as large as the interval set
+        strategy = points.size() / threads >= tree.center_count ? batch_strategy::sweep : batch_strategy::parallel;
+    }
+
+    return strategy == batch_strategy::sweep ? batch_query::sweep_queries(tree, points, threads)
+                                             : batch_query::parallel_queries(tree, points, threads);
+}
+
+template <typename T, typename P>
+std::vector<int> get_numb_of_intervals(const flat_interval_tree<T, P> &tree, const std::vector<T> &points,
+                                       batch_strategy strategy = batch_strategy::automatic,
+                                       unsigned threads = 0) {
+    return get_numb_of_intervals(tree.view(), points, strategy, threads);
+}
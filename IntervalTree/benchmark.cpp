@@ -0,0 +1,241 @@
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "interval_tree_node.h"
+#include "flat_interval_tree.h"
+
+using namespace std;
+
+// usage: IntervalTreeBenchmark [n [queries [seed]]]
+// builds every dataset with interval_tree_node and queries it next to a naive scan and a sort-sweep
+// baseline, the results are printed as one JSON object
+
+// the naive scan is linear per query, it only gets this many of them
+const size_t NAIVE_QUERY_LIMIT = 1000;
+
+using clock_type = chrono::steady_clock;
+
+double elapsed_ms(clock_type::time_point since) {
+    return chrono::duration<double, milli>(clock_type::now() - since).count();
+}
+
+struct dataset {
+    string name;
+    vector<pair<int, int>> intervals;
+};
+
+int random_in(mt19937 &rng, int low, int high) {
+    return uniform_int_distribution<int>(low, high)(rng);
+}
+
+/// starts and lengths uniform over the whole range
+vector<pair<int, int>> uniform_intervals(size_t n, mt19937 &rng) {
+    vector<pair<int, int>> result(n);
+    for (auto &i: result) {
+        i.first = random_in(rng, 0, 100000000);
+        i.second = i.first + random_in(rng, 0, 10000);
+    }
+    return result;
+}
+
+/// short intervals around a few hot spots
+vector<pair<int, int>> clustered_intervals(size_t n, mt19937 &rng) {
+    vector<int> centers(16);
+    for (auto &c: centers)
+        c = random_in(rng, 0, 100000000);
+
+    normal_distribution<double> offset(0, 5000);
+    vector<pair<int, int>> result(n);
+    for (auto &i: result) {
+        i.first = centers[random_in(rng, 0, (int)centers.size() - 1)] + (int)offset(rng);
+        i.second = i.first + random_in(rng, 0, 1000);
+    }
+    return result;
+}
+
+/// chains of intervals nested inside each other, every point is covered by many of them
+vector<pair<int, int>> nested_intervals(size_t n, mt19937 &rng) {
+    vector<pair<int, int>> result(n);
+    const size_t CHAIN = 1000;
+    for (size_t i = 0; i < n; ++i) {
+        int center = (int)(i / CHAIN) * 250000, shrink = (int)(i % CHAIN) * 100;
+        result[i] = {center - 100000 + shrink + random_in(rng, 0, 99), center + 100000 - shrink};
+    }
+    shuffle(result.begin(), result.end(), rng);
+    return result;
+}
+
+/// mostly short intervals with a Pareto tail of very long ones
+vector<pair<int, int>> heavy_tailed_intervals(size_t n, mt19937 &rng) {
+    uniform_real_distribution<double> u(0, 1);
+    vector<pair<int, int>> result(n);
+    for (auto &i: result) {
+        i.first = random_in(rng, 0, 100000000);
+        double length = 10 / pow(1 - u(rng), 1 / 1.1);
+        i.second = i.first + (int)min(length, 100000000.0);
+    }
+    return result;
+}
+
+/// every interval is the same single point
+vector<pair<int, int>> degenerate_intervals(size_t n, mt19937 &) {
+    return vector<pair<int, int>>(n, {42, 42});
+}
+
+/// query points mostly inside the covered range, some of them hitting endpoints exactly
+vector<int> query_points(const vector<pair<int, int>> &intervals, size_t count, mt19937 &rng) {
+    int low = INT_MAX, high = INT_MIN;
+    for (const auto &i: intervals) {
+        low = min(low, i.first);
+        high = max(high, i.second);
+    }
+
+    vector<int> result(count);
+    for (auto &p: result) {
+        if (!intervals.empty() && random_in(rng, 0, 3) == 0) {
+            const auto &i = intervals[random_in(rng, 0, (int)intervals.size() - 1)];
+            p = random_in(rng, 0, 1) ? i.first : i.second;
+        } else {
+            p = random_in(rng, low, high);
+        }
+    }
+    return result;
+}
+
+/// bytes held by a pointer-based tree: the nodes and the capacity of their columns
+size_t memory_footprint(const interval_tree_node<> *root) {
+    if (!root)
+        return 0;
+    return sizeof(*root) + root->starts.capacity() * sizeof(int) + root->ends.capacity() * sizeof(int)
+           + (root->payloads_by_start.capacity() + root->payloads_by_end.capacity()) * sizeof(int)
+           + memory_footprint(root->left_node.get()) + memory_footprint(root->right_node.get());
+}
+
+size_t memory_footprint(const flat_interval_tree<> &tree) {
+    return tree.nodes.capacity() * sizeof(tree.nodes[0])
+           + (tree.starts.capacity() + tree.ends.capacity()) * sizeof(int)
+           + (tree.payloads_by_start.capacity() + tree.payloads_by_end.capacity()) * sizeof(int);
+}
+
+/// runs the query on every point and prints its latency and throughput
+/// \param query returns something derived from the answer, summed so that the work can't be dropped
+void measure(const string &name, const vector<int> &points, size_t limit, const function<size_t(int)> &query,
+             bool last) {
+    size_t count = min(limit, points.size()), checksum = 0;
+    auto start = clock_type::now();
+    for (size_t i = 0; i < count; ++i)
+        checksum += query(points[i]);
+    double ms = elapsed_ms(start);
+
+    cout << "        \"" << name << "\": {\"queries\": " << count
+         << ", \"ns_per_query\": " << (count ? ms * 1e6 / count : 0)
+         << ", \"queries_per_second\": " << (ms > 0 ? count / ms * 1e3 : 0)
+         << ", \"checksum\": " << checksum << "}" << (last ? "\n" : ",\n");
+}
+
+void run(const dataset &data, size_t query_count, mt19937 &rng, bool last) {
+    const auto &intervals = data.intervals;
+    vector<int> points = query_points(intervals, query_count, rng);
+
+    auto start = clock_type::now();
+    auto tree = make_unique<interval_tree_node<>>(intervals);
+    double build_ms = elapsed_ms(start);
+    start = clock_type::now();
+    flat_interval_tree<> flat_tree(*tree);
+    double flat_build_ms = elapsed_ms(start);
+    interval_tree_stats stats = tree->get_stats();
+
+    // sort-sweep baseline: count(p) = #{start <= p} - #{end < p} over two sorted columns
+    start = clock_type::now();
+    vector<int> starts, ends;
+    for (const auto &i: intervals) {
+        starts.push_back(i.first);
+        ends.push_back(i.second);
+    }
+    sort(starts.begin(), starts.end());
+    sort(ends.begin(), ends.end());
+    double sweep_build_ms = elapsed_ms(start);
+
+    cout << "    \"" << data.name << "\": {\n"
+         << "      \"intervals\": " << intervals.size() << ",\n"
+         << "      \"build_ms\": {\"tree\": " << build_ms << ", \"flat_tree\": " << build_ms + flat_build_ms
+         << ", \"sort_sweep\": " << sweep_build_ms << "},\n"
+         << "      \"memory_bytes\": {\"tree\": " << memory_footprint(tree.get()) << ", \"flat_tree\": "
+         << memory_footprint(flat_tree) << ", \"sort_sweep\": " << 2 * intervals.size() * sizeof(int) << "},\n"
+         << "      \"depth\": " << stats.depth << ",\n"
+         << "      \"node_count\": " << stats.node_count << ",\n"
+         << "      \"max_center_size\": " << stats.max_center_size << ",\n"
+         << "      \"count\": {\n";
+
+    measure("tree", points, points.size(), [&](int p) { return (size_t)tree->get_numb_of_intervals(p); }, false);
+    measure("flat_tree", points, points.size(), [&](int p) { return (size_t)flat_tree.get_numb_of_intervals(p); },
+            false);
+    measure("sort_sweep", points, points.size(), [&](int p) {
+        return (size_t)((upper_bound(starts.begin(), starts.end(), p) - starts.begin())
+                        - (lower_bound(ends.begin(), ends.end(), p) - ends.begin()));
+    }, false);
+    measure("naive_scan", points, NAIVE_QUERY_LIMIT, [&](int p) {
+        size_t result = 0;
+        for (const auto &i: intervals)
+            result += i.first <= p && p <= i.second;
+        return result;
+    }, true);
+
+    cout << "      },\n"
+         << "      \"report\": {\n";
+
+    auto reported = [](const vector<interval_span<int>> &spans) {
+        size_t result = 0;
+        for (const auto &s: spans)
+            for (int id: s)
+                result += id;
+        return result;
+    };
+    measure("tree", points, points.size(), [&](int p) { return reported(tree->get_intervals(p)); }, false);
+    measure("flat_tree", points, points.size(), [&](int p) { return reported(flat_tree.get_intervals(p)); },
+            false);
+    measure("naive_scan", points, NAIVE_QUERY_LIMIT, [&](int p) {
+        size_t result = 0;
+        for (size_t i = 0; i < intervals.size(); ++i)
+            if (intervals[i].first <= p && p <= intervals[i].second)
+                result += i;
+        return result;
+    }, true);
+
+    cout << "      }\n"
+         << "    }" << (last ? "\n" : ",\n");
+}
+
+int main(int argc, char **argv) {
+    size_t n = argc > 1 ? stoul(argv[1]) : 100000, query_count = argc > 2 ? stoul(argv[2]) : 10000;
+    mt19937 rng(argc > 3 ? stoul(argv[3]) : 1);
+
+    vector<pair<string, function<vector<pair<int, int>>(size_t, mt19937 &)>>> generators = {
+            {"uniform",      uniform_intervals},
+            {"clustered",    clustered_intervals},
+            {"nested",       nested_intervals},
+            {"heavy_tailed", heavy_tailed_intervals},
+            {"degenerate",   degenerate_intervals}
+    };
+
+    cout << "{\n"
+         << "  \"n\": " << n << ",\n"
+         << "  \"queries\": " << query_count << ",\n"
+         << "  \"datasets\": {\n";
+    for (size_t i = 0; i < generators.size(); ++i) {
+        dataset data{generators[i].first, generators[i].second(n, rng)};
+        run(data, query_count, rng, i + 1 == generators.size());
+    }
+    cout << "  }\n"
+         << "}\n";
+
+    return 0;
+}
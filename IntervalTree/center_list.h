@@ -0,0 +1,123 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// the AVX2 kernel is compiled for its own function only and picked at runtime, so the binary
+// still runs on x86 CPUs without AVX2
+#if defined(INTERVAL_TREE_AVX2) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define INTERVAL_TREE_AVX2_KERNEL
+#include <immintrin.h>
+#endif
+
+#include "interval.h"
+
+namespace center_kernels {
+    // below this many elements a branch-free linear count beats further halving
+    constexpr size_t LINEAR_WINDOW = 64;
+
+#ifdef INTERVAL_TREE_AVX2_KERNEL
+    inline bool has_avx2() {
+        static const bool supported = __builtin_cpu_supports("avx2");
+        return supported;
+    }
+
+    /// linear_count over the first n / 8 * 8 elements, 8 at a time
+    template <bool inclusive>
+    __attribute__((target("avx2"))) size_t linear_count_avx2(const int32_t *first, size_t n, int32_t point) {
+        size_t result = 0;
+        __m256i p = _mm256_set1_epi32(point);
+        for (size_t i = 0; i + 8 <= n; i += 8) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(first + i));
+            // v <= p is !(v > p), v < p is p > v
+            __m256i mask = inclusive ? _mm256_cmpgt_epi32(v, p) : _mm256_cmpgt_epi32(p, v);
+            int bits = __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(mask)));
+            result += inclusive ? 8 - bits : bits;
+        }
+        return result;
+    }
+#endif
+
+    /// number of elements of [first, last) that are less than the point (inclusive = false)
+    /// or not greater than it (inclusive = true), the range doesn't have to be sorted
+    template <bool inclusive, typename T>
+    size_t linear_count(const T *first, const T *last, T point) {
+        size_t n = last - first, result = 0, i = 0;
+
+#ifdef INTERVAL_TREE_AVX2_KERNEL
+        if constexpr (std::is_same_v<T, int32_t>) {
+            if (has_avx2()) {
+                i = n / 8 * 8;
+                result = linear_count_avx2<inclusive>(first, n, point);
+            }
+        }
+#endif
+
+        for (; i < n; ++i)
+            result += inclusive ? !(point < first[i]) : first[i] < point;
+        return result;
+    }
+
+    /// number of elements of the sorted range that are less than the point (inclusive = false)
+    /// or not greater than it (inclusive = true)
+    template <bool inclusive, typename T>
+    size_t count(const T *first, const T *last, T point) {
+        const T *begin = first;
+
+        // binary search down to a small window, then count the window without branches
+        while ((size_t)(last - first) > LINEAR_WINDOW) {
+            const T *mid = first + (last - first) / 2;
+            if (inclusive ? !(point < *mid) : *mid < point)
+                first = mid + 1;
+            else
+                last = mid;
+        }
+
+        return (first - begin) + linear_count<inclusive>(first, last, point);
+    }
+}
+
+/// Center list of one node stored as structure of arrays: starts sorted ascending and ends
+/// sorted ascending, each with its payloads in the same order. Every interval of the list
+/// contains x_median, so a query left of the median only has to look at starts and vice versa.
+template <typename T, typename P>
+struct center_view {
+    using payload_type = stored_payload_t<P>;
+    using span_type = interval_span<payload_type>;
+
+    const T *starts, *ends;
+    const payload_type *by_start, *by_end;
+    size_t size;
+
+    /// number of intervals containing the point
+    [[nodiscard]] size_t count_containing(T point, T x_median) const {
+        if (point <= x_median)
+            return center_kernels::count<true>(starts, starts + size, point);
+        return size - center_kernels::count<false>(ends, ends + size, point);
+    }
+
+    [[nodiscard]] span_type containing(T point, T x_median) const {
+        size_t found = count_containing(point, x_median);
+        if (point <= x_median)
+            return {by_start, by_start + found};
+        return {by_end + size - found, by_end + size};
+    }
+
+    /// number of intervals overlapping [left, right]
+    [[nodiscard]] size_t count_overlapping(T left, T right, T x_median) const {
+        if (right < x_median)
+            return center_kernels::count<true>(starts, starts + size, right);
+        if (left > x_median)
+            return size - center_kernels::count<false>(ends, ends + size, left);
+        return size;
+    }
+
+    [[nodiscard]] span_type overlapping(T left, T right, T x_median) const {
+        size_t found = count_overlapping(left, right, x_median);
+        if (left > x_median)
+            return {by_end + size - found, by_end + size};
+        return {by_start, by_start + found};
+    }
+};
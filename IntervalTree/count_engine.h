@@ -0,0 +1,174 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+#include "interval.h"
+
+/// Count-only stabbing engines over compressed coordinates.
+/// The distinct endpoints c_0 < c_1 < ... < c_{m-1} split the line into 2m - 1 elementary pieces:
+/// the points c_i (slot 2i) and the open gaps (c_i, c_{i+1}) (slot 2i + 1). An interval [c_s, c_e]
+/// covers exactly the slots 2s..2e, so the coverage of every slot is a prefix sum of +1/-1 events.
+namespace count_engine_detail {
+    template <typename T>
+    std::vector<T> universe(std::vector<T> coords) {
+        std::sort(coords.begin(), coords.end());
+        coords.erase(std::unique(coords.begin(), coords.end()), coords.end());
+        return coords;
+    }
+
+    template <typename T, typename P>
+    std::vector<T> endpoints(const std::vector<interval<T, P>> &intervals) {
+        std::vector<T> coords;
+        coords.reserve(2 * intervals.size());
+        for (const auto &i: intervals) {
+            coords.push_back(i.start);
+            coords.push_back(i.end);
+        }
+        return universe(std::move(coords));
+    }
+
+    /// positions of both endpoints of [start, end] in a sorted universe
+    /// \return false if an endpoint is not in the universe or end < start, s and e are left untouched then
+    template <typename T>
+    bool endpoint_indices(const std::vector<T> &coords, T start, T end, size_t &s, size_t &e) {
+        auto first = std::lower_bound(coords.begin(), coords.end(), start),
+                last = std::lower_bound(coords.begin(), coords.end(), end);
+        if (first == coords.end() || *first != start || last == coords.end() || *last != end || end < start)
+            return false;
+
+        s = first - coords.begin();
+        e = last - coords.begin();
+        return true;
+    }
+
+    /// slot of the elementary piece containing the point, -1 before the first endpoint
+    template <typename T>
+    long slot_of(const std::vector<T> &coords, T point) {
+        long i = std::upper_bound(coords.begin(), coords.end(), point) - coords.begin() - 1;
+        if (i < 0)
+            return -1;
+        return coords[i] == point ? 2 * i : 2 * i + 1;
+    }
+
+    template <typename T>
+    std::vector<interval<T, int>> with_ids(const std::vector<std::pair<T, T>> &intervals) {
+        std::vector<interval<T, int>> result;
+        result.reserve(intervals.size());
+        for (const auto &i: intervals)
+            result.push_back({i.first, i.second, (int)result.size()});
+        return result;
+    }
+}
+
+/// Static engine: coverage of every slot is precomputed, a query is one binary search and one read.
+template <typename T = int>
+class prefix_count_engine {
+private:
+    std::vector<T> coords;
+    std::vector<int> coverage; // 2m slots, the last gap is always empty
+
+public:
+    explicit prefix_count_engine(const std::vector<std::pair<T, T>> &intervals)
+            : prefix_count_engine(count_engine_detail::with_ids(intervals)) {}
+
+    template <typename P>
+    explicit prefix_count_engine(const std::vector<interval<T, P>> &intervals)
+            : coords(count_engine_detail::endpoints(intervals)), coverage(2 * coords.size() + 1) {
+        for (const auto &i: intervals) {
+            size_t s = std::lower_bound(coords.begin(), coords.end(), i.start) - coords.begin(),
+                    e = std::lower_bound(coords.begin(), coords.end(), i.end) - coords.begin();
+            coverage[2 * s]++;
+            coverage[2 * e + 1]--;
+        }
+        for (size_t i = 1; i < coverage.size(); ++i)
+            coverage[i] += coverage[i - 1];
+        coverage.pop_back();
+    }
+
+    /// number of intervals containing the point, O(log m)
+    [[nodiscard]] int get_numb_of_intervals(T point) const {
+        long slot = count_engine_detail::slot_of(coords, point);
+        return slot < 0 ? 0 : coverage[slot];
+    }
+};
+
+/// Updatable engine: a Fenwick tree over the slot differences of a fixed coordinate universe.
+/// Intervals can be added and removed as long as both endpoints belong to the universe.
+template <typename T = int>
+class fenwick_count_engine {
+private:
+    std::vector<T> coords;
+    std::vector<int> tree; // 1-based Fenwick tree over 2m + 1 difference slots
+
+    void add_at(size_t slot, int delta) {
+        for (size_t i = slot + 1; i < tree.size(); i += i & (~i + 1))
+            tree[i] += delta;
+    }
+
+    [[nodiscard]] int prefix_sum(size_t slot) const {
+        int result = 0;
+        for (size_t i = slot + 1; i > 0; i -= i & (~i + 1))
+            result += tree[i];
+        return result;
+    }
+
+    bool update(T start, T end, int delta) {
+        size_t s, e;
+        if (!count_engine_detail::endpoint_indices(coords, start, end, s, e))
+            return false;
+
+        add_at(2 * s, delta);
+        add_at(2 * e + 1, -delta);
+        return true;
+    }
+
+public:
+    /// \param universe all coordinates intervals may ever start or end at, in any order
+    explicit fenwick_count_engine(std::vector<T> universe)
+            : coords(count_engine_detail::universe(std::move(universe))) {
+        tree.assign(2 * coords.size() + 2, 0);
+    }
+
+    /// universe made of the endpoints of the given intervals, which are added right away
+    template <typename P>
+    explicit fenwick_count_engine(const std::vector<interval<T, P>> &intervals)
+            : fenwick_count_engine(count_engine_detail::endpoints(intervals)) {
+        for (const auto &i: intervals)
+            insert(i.start, i.end);
+    }
+
+    /// adds [start, end], O(log m)
+    /// \return false if an endpoint is outside the universe or end < start, nothing is changed then
+    bool insert(T start, T end) {
+        return update(start, end, 1);
+    }
+
+    /// removes one [start, end] added before, O(log m)
+    /// \return false if an endpoint is outside the universe or end < start, nothing is changed then
+    bool erase(T start, T end) {
+        return update(start, end, -1);
+    }
+
+    /// number of intervals containing the point, O(log m)
+    [[nodiscard]] int get_numb_of_intervals(T point) const {
+        long slot = count_engine_detail::slot_of(coords, point);
+        return slot < 0 ? 0 : prefix_sum(slot);
+    }
+};
+
+enum class interval_engine {
+    flat_tree,    // static, counting and reporting
+    dynamic_tree, // updatable, counting and reporting
+    prefix_sums,  // static, counting only: smallest and fastest
+    fenwick       // updatable over a fixed coordinate universe, counting only
+};
+
+/// picks the cheapest engine that supports the workload
+/// \param reporting whether the matching intervals themselves are needed
+/// \param updates whether the interval set changes after the build
+inline interval_engine choose_engine(bool reporting, bool updates) {
+    if (reporting)
+        return updates ? interval_engine::dynamic_tree : interval_engine::flat_tree;
+    return updates ? interval_engine::fenwick : interval_engine::prefix_sums;
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+#include "count_engine.h"
+
+/// deepest point of a range: the number of intervals containing it and the leftmost point where it happens
+template <typename T>
+struct max_coverage {
+    int depth;
+    T point;
+};
+
+/// Range-maximum coverage over the compressed slots of count_engine.h: a segment tree with
+/// range add and range max stores the coverage of every point and gap slot, an interval [c_s, c_e]
+/// adds one to the slots 2s..2e. Intervals can be added and removed as long as both endpoints
+/// belong to the coordinate universe.
+template <typename T = int>
+class coverage_tree {
+private:
+    std::vector<T> coords;
+    size_t slots; // 2m - 1: the points c_i and the gaps between them
+    // max of the subtree plus everything added to the whole subtree at once, which is kept in add
+    std::vector<int> max, add;
+
+    void update(size_t node, size_t lo, size_t hi, size_t from, size_t to, int delta) {
+        if (to < lo || hi < from)
+            return;
+        if (from <= lo && hi <= to) {
+            max[node] += delta;
+            add[node] += delta;
+            return;
+        }
+
+        size_t mid = (lo + hi) / 2;
+        update(2 * node, lo, mid, from, to, delta);
+        update(2 * node + 1, mid + 1, hi, from, to, delta);
+        max[node] = std::max(max[2 * node], max[2 * node + 1]) + add[node];
+    }
+
+    /// maximum over the slots [from, to] and the leftmost slot holding it
+    [[nodiscard]] std::pair<int, size_t> query(size_t node, size_t lo, size_t hi, size_t from, size_t to) const {
+        if (from <= lo && hi <= to) {
+            // descend to the leftmost slot reaching the maximum of the subtree
+            int depth = max[node];
+            for (int target = max[node] - add[node]; lo != hi;) {
+                size_t mid = (lo + hi) / 2;
+                if (max[2 * node] == target) {
+                    node = 2 * node;
+                    hi = mid;
+                } else {
+                    node = 2 * node + 1;
+                    lo = mid + 1;
+                }
+                target -= add[node];
+            }
+            return {depth, lo};
+        }
+
+        size_t mid = (lo + hi) / 2;
+        std::pair<int, size_t> result;
+        if (to <= mid)
+            result = query(2 * node, lo, mid, from, to);
+        else if (from > mid)
+            result = query(2 * node + 1, mid + 1, hi, from, to);
+        else {
+            auto left = query(2 * node, lo, mid, from, to), right = query(2 * node + 1, mid + 1, hi, from, to);
+            result = right.first > left.first ? right : left;
+        }
+        result.first += add[node];
+        return result;
+    }
+
+    bool update(T start, T end, int delta) {
+        size_t s, e;
+        if (!count_engine_detail::endpoint_indices(coords, start, end, s, e))
+            return false;
+
+        update(1, 0, slots - 1, 2 * s, 2 * e, delta);
+        return true;
+    }
+
+public:
+    /// empty tree over a coordinate universe, as fenwick_count_engine
+    explicit coverage_tree(std::vector<T> universe) : coords(count_engine_detail::universe(std::move(universe))) {
+        slots = std::max<size_t>(1, 2 * coords.size()) - 1;
+        max.assign(4 * std::max<size_t>(1, slots), 0);
+        add.assign(max.size(), 0);
+    }
+
+    explicit coverage_tree(const std::vector<std::pair<T, T>> &intervals)
+            : coverage_tree(count_engine_detail::with_ids(intervals)) {}
+
+    /// tree over the endpoints of the given intervals, holding all of them
+    template <typename P>
+    explicit coverage_tree(const std::vector<interval<T, P>> &intervals)
+            : coverage_tree(count_engine_detail::endpoints(intervals)) {
+        for (const auto &i: intervals)
+            insert(i.start, i.end);
+    }
+
+    /// range add over the slots of [start, end], O(log m)
+    /// \return false, changing nothing, on the same endpoints fenwick_count_engine::insert rejects
+    bool insert(T start, T end) {
+        return update(start, end, 1);
+    }
+
+    /// takes back one insert of [start, end], O(log m)
+    /// \return false, changing nothing, on the same endpoints fenwick_count_engine::erase rejects
+    bool erase(T start, T end) {
+        return update(start, end, -1);
+    }
+
+    /// number of intervals containing the point, O(log m)
+    [[nodiscard]] int get_numb_of_intervals(T point) const {
+        return get_max_coverage(point, point).depth;
+    }
+
+    /// maximal number of intervals containing one point of [left, right], O(log m)
+    /// \return the depth and the leftmost point of the range reaching it
+    [[nodiscard]] max_coverage<T> get_max_coverage(T left, T right) const {
+        long from = count_engine_detail::slot_of(coords, left), to = count_engine_detail::slot_of(coords, right);
+        // everything before c_0 and after c_{m-1} is covered by nothing
+        to = std::min<long>(to, (long)slots - 1);
+        from = std::max<long>(from, 0);
+        if (coords.empty() || right < left || to < from)
+            return {0, left};
+
+        auto [depth, slot] = query(1, 0, slots - 1, from, to);
+        // a gap is covered by no more intervals than the point to its left, so the leftmost maximum
+        // falls on a gap only if it is the gap holding left
+        if (depth <= 0)
+            return {0, left};
+        return {depth, slot % 2 == 0 ? coords[slot / 2] : left};
+    }
+};
@@ -0,0 +1,228 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include "interval.h"
+
+/// Interval tree supporting insertions and deletions.
+/// Intervals are kept in two treaps: one ordered by start and augmented with the maximal end
+/// of every subtree (used for reporting), the other ordered by end. Both carry subtree sizes,
+/// so counting is #{start <= point} - #{end < point}.
+/// \tparam T coordinate type
+/// \tparam P payload type, has to be ordered by operator< unless it is void
+template <typename T = int, typename P = int>
+class dynamic_interval_tree {
+public:
+    using interval_type = interval<T, P>;
+
+private:
+    struct node {
+        interval_type value;
+        uint32_t priority;
+        T max_end; // maximal end in the subtree, maintained in the start-ordered treap only
+        int size;
+        node *left = nullptr, *right = nullptr;
+
+        node(const interval_type &i, uint32_t p) : value(i), priority(p), max_end(i.end), size(1) {}
+    };
+
+    node *by_start = nullptr, *by_end = nullptr;
+    uint32_t seed = 2463534242u;
+
+    static bool payload_less(const interval_type &a, const interval_type &b) {
+        if constexpr (std::is_void_v<P>)
+            return false;
+        else
+            return a.payload < b.payload;
+    }
+
+    static bool start_less(const interval_type &a, const interval_type &b) {
+        if (a.start != b.start)
+            return a.start < b.start;
+        if (a.end != b.end)
+            return a.end < b.end;
+        return payload_less(a, b);
+    }
+
+    static bool end_less(const interval_type &a, const interval_type &b) {
+        if (a.end != b.end)
+            return a.end < b.end;
+        if (a.start != b.start)
+            return a.start < b.start;
+        return payload_less(a, b);
+    }
+
+    uint32_t next_priority() {
+        // xorshift32
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return seed;
+    }
+
+    static void update(node *n) {
+        n->size = 1;
+        n->max_end = n->value.end;
+        for (node *child: {n->left, n->right}) {
+            if (child) {
+                n->size += child->size;
+                n->max_end = std::max(n->max_end, child->max_end);
+            }
+        }
+    }
+
+    /// splits t into keys less than i and the rest
+    template <typename Less>
+    static void split(node *t, const interval_type &i, node *&l, node *&r, Less less) {
+        if (!t) {
+            l = r = nullptr;
+        } else if (less(t->value, i)) {
+            split(t->right, i, t->right, r, less);
+            l = t;
+            update(l);
+        } else {
+            split(t->left, i, l, t->left, less);
+            r = t;
+            update(r);
+        }
+    }
+
+    static node *merge(node *l, node *r) {
+        if (!l || !r)
+            return l ? l : r;
+
+        if (l->priority > r->priority) {
+            l->right = merge(l->right, r);
+            update(l);
+            return l;
+        }
+        r->left = merge(l, r->left);
+        update(r);
+        return r;
+    }
+
+    template <typename Less>
+    static node *insert(node *t, node *n, Less less) {
+        node *l, *r;
+        split(t, n->value, l, r, less);
+        return merge(merge(l, n), r);
+    }
+
+    /// removes the node equal to i from t
+    /// \return new root, removed node or nullptr goes to removed
+    template <typename Less>
+    static node *erase(node *t, const interval_type &i, node *&removed, Less less) {
+        if (!t)
+            return nullptr;
+
+        if (t->value == i) {
+            removed = t;
+            return merge(t->left, t->right);
+        }
+        if (less(i, t->value))
+            t->left = erase(t->left, i, removed, less);
+        else
+            t->right = erase(t->right, i, removed, less);
+
+        update(t);
+        return t;
+    }
+
+    static void destroy(node *t) {
+        if (!t)
+            return;
+        destroy(t->left);
+        destroy(t->right);
+        delete t;
+    }
+
+    static void collect(const node *t, T point, std::vector<interval_type> &result) {
+        if (!t || t->max_end < point)
+            return;
+
+        collect(t->left, point, result);
+        if (t->value.start <= point) {
+            if (t->value.end >= point)
+                result.push_back(t->value);
+            collect(t->right, point, result);
+        }
+    }
+
+public:
+    dynamic_interval_tree() = default;
+
+    explicit dynamic_interval_tree(const std::vector<interval_type> &intervals) {
+        for (const auto &i: intervals)
+            insert(i);
+    }
+
+    dynamic_interval_tree(const dynamic_interval_tree &) = delete;
+
+    dynamic_interval_tree &operator=(const dynamic_interval_tree &) = delete;
+
+    virtual ~dynamic_interval_tree() {
+        destroy(by_start);
+        destroy(by_end);
+    }
+
+    /// adds an interval, O(log n)
+    void insert(const interval_type &i) {
+        by_start = insert(by_start, new node(i, next_priority()), start_less);
+        by_end = insert(by_end, new node(i, next_priority()), end_less);
+    }
+
+    /// removes an interval equal to i (start, end and payload), O(log n)
+    /// \return was there such an interval
+    bool erase(const interval_type &i) {
+        node *removed = nullptr;
+        by_start = erase(by_start, i, removed, start_less);
+        if (!removed)
+            return false;
+        delete removed;
+
+        removed = nullptr;
+        by_end = erase(by_end, i, removed, end_less);
+        delete removed;
+
+        return true;
+    }
+
+    [[nodiscard]] int size() const {
+        return by_start ? by_start->size : 0;
+    }
+
+    /// number of intervals containing the point, O(log n)
+    [[nodiscard]] int get_numb_of_intervals(T point) const {
+        int result = 0;
+
+        // intervals starting at or before the point ...
+        for (const node *t = by_start; t;) {
+            if (t->value.start <= point) {
+                result += (t->left ? t->left->size : 0) + 1;
+                t = t->right;
+            } else {
+                t = t->left;
+            }
+        }
+        // ... minus those of them that have already ended
+        for (const node *t = by_end; t;) {
+            if (t->value.end < point) {
+                result -= (t->left ? t->left->size : 0) + 1;
+                t = t->right;
+            } else {
+                t = t->left;
+            }
+        }
+
+        return result;
+    }
+
+    /// all intervals containing the point, ordered by start
+    [[nodiscard]] std::vector<interval_type> get_intervals(T point) const {
+        std::vector<interval_type> result;
+        collect(by_start, point, result);
+        return result;
+    }
+};
@@ -0,0 +1,305 @@
+#pragma once
+
+#include <climits>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "interval_tree_node.h"
+#include "interval_index_file.h"
+#include "external_sort.h"
+
+/// Builds an index file from an interval file larger than the memory available.
+/// Nodes are split at the median endpoint as in interval_tree_node, but a node whose intervals
+/// don't fit the memory budget is built from files: the median comes from an external sort of
+/// its endpoints, the intervals are streamed into left, center and right files, and the center
+/// list is sorted externally by start and by end. Once a subtree fits the budget it is built
+/// in memory. Nodes are written in preorder, so the index of a left child is always known up front
+/// and only right children of file-built nodes are patched when the index is composed.
+template <typename T = int, typename P = int>
+class external_interval_builder {
+public:
+    using interval_type = interval<T, P>;
+    using payload_type = stored_payload_t<P>;
+    using node = flat_interval_node<T>;
+
+    /// \param index_path index file to write, temporary files are created next to it
+    /// \param memory_budget approximate number of bytes the build may keep in memory
+    external_interval_builder(std::string index_path, size_t memory_budget)
+            : index_path(std::move(index_path)), memory_budget(memory_budget),
+              nodes(column_path("nodes")), starts(column_path("starts")), ends(column_path("ends")),
+              payloads_by_start(column_path("payloads_by_start")), payloads_by_end(column_path("payloads_by_end")) {}
+
+    /// builds the index of all intervals of the file
+    /// \param intervals_path file of interval<T, P> records as they are laid out in memory
+    /// \return false if a file couldn't be read or written
+    bool build(const std::string &intervals_path) {
+        // a failure still falls through to the cleanup of the column files
+        std::ifstream in(intervals_path, std::ios::binary | std::ios::ate);
+        ok = in.is_open();
+        size_t count = ok ? (size_t)in.tellg() / sizeof(interval_type) : 0;
+        in.close();
+        // nodes address the center pools with int offsets
+        ok = ok && count <= INT_MAX;
+
+        build_subtree(intervals_path, count, false);
+        bool closed = nodes.close() & starts.close() & ends.close()
+                & payloads_by_start.close() & payloads_by_end.close();
+        ok = ok && closed && compose();
+
+        for (const char *column: COLUMNS)
+            std::remove(column_path(column).c_str());
+        return ok;
+    }
+
+private:
+    // the in-memory build keeps about this many bytes per byte of its input:
+    // the input, its working copy, the endpoint scratch, the radix buffer and the columns
+    static constexpr size_t IN_MEMORY_FACTOR = 6;
+    static constexpr const char *COLUMNS[] = {"nodes", "starts", "ends", "payloads_by_start", "payloads_by_end"};
+
+    std::string index_path;
+    size_t memory_budget;
+    int next_temp = 0;
+    bool ok = true;
+
+    record_file::writer<node> nodes;
+    record_file::writer<T> starts, ends;
+    record_file::writer<payload_type> payloads_by_start, payloads_by_end;
+    std::vector<std::pair<size_t, int>> right_patches; // node index, index of its right child
+
+    /// file collecting one section of the index until it is composed
+    [[nodiscard]] std::string column_path(const char *column) const {
+        return index_path + "." + column;
+    }
+
+    std::string temp_path() {
+        return index_path + ".tmp" + std::to_string(next_temp++);
+    }
+
+    /// builds the subtree of the count intervals in the file
+    /// \param owned whether the file is a temporary one to delete once read
+    /// \return index of the subtree root, -1 for an empty subtree
+    int build_subtree(const std::string &path, size_t count, bool owned) {
+        // after a failure the partition may be wrong, so nothing below is built
+        if (count == 0 || !ok) {
+            if (owned)
+                std::remove(path.c_str());
+            return -1;
+        }
+
+        if (count == 1 || count * sizeof(interval_type) * IN_MEMORY_FACTOR <= memory_budget) {
+            std::vector<interval_type> intervals(count);
+            record_file::reader<interval_type> in(path);
+            ok &= in.read(intervals.data(), count) == count && !in.failed();
+            if (owned)
+                std::remove(path.c_str());
+            if (!ok)
+                return -1;
+
+            interval_tree_node<T, P> tree(intervals);
+            intervals = std::vector<interval_type>();
+            return emit(tree);
+        }
+
+        T x_median = median_endpoint(path, count);
+        if (!ok) {
+            if (owned)
+                std::remove(path.c_str());
+            return -1;
+        }
+        std::string left_path = temp_path(), center_path = temp_path(), right_path = temp_path();
+        node packed{x_median, interval_tree_node<T, P>::MAX_X, interval_tree_node<T, P>::MIN_X, -1, -1,
+                    (int)starts.size(), 0, (int)count};
+        size_t left_size, right_size;
+        {
+            record_file::reader<interval_type> in(path);
+            record_file::writer<interval_type> left(left_path), center(center_path), right(right_path);
+            for (interval_type i; in.next(i);) {
+                packed.low = std::min(packed.low, i.start);
+                packed.high = std::max(packed.high, i.end);
+                if (i.end < x_median)
+                    left.push(i);
+                else if (i.start <= x_median)
+                    center.push(i);
+                else
+                    right.push(i);
+            }
+            left_size = left.size();
+            right_size = right.size();
+            packed.center_size = (int)center.size();
+            ok &= left.close() & center.close() & right.close() && !in.failed()
+                    && left_size + packed.center_size + right_size == count;
+        }
+        if (owned)
+            std::remove(path.c_str());
+        // the median is an endpoint, so a correct partition always leaves it out of both sides;
+        // a side as large as the node would recurse forever
+        ok = ok && left_size < count && right_size < count;
+        if (!ok) {
+            for (const auto &temp: {left_path, center_path, right_path})
+                std::remove(temp.c_str());
+            return -1;
+        }
+
+        write_center(center_path);
+
+        size_t index = nodes.size();
+        if (left_size != 0)
+            packed.left_node = (int)index + 1;
+        nodes.push(packed);
+
+        build_subtree(left_path, left_size, true);
+        int right_node = build_subtree(right_path, right_size, true);
+        if (right_node != -1)
+            right_patches.emplace_back(index, right_node);
+        return (int)index;
+    }
+
+    /// median of the 2 * count endpoints in the file, see interval_tree_node::median_endpoint
+    T median_endpoint(const std::string &path, size_t count) {
+        std::string endpoints_path = temp_path(), sorted_path = temp_path();
+        {
+            record_file::reader<interval_type> in(path);
+            record_file::writer<T> endpoints(endpoints_path);
+            for (interval_type i; in.next(i);) {
+                endpoints.push(i.start);
+                endpoints.push(i.end);
+            }
+            ok &= endpoints.close();
+        }
+        ok &= external_sort<T>(endpoints_path, sorted_path, std::less<T>(), memory_budget);
+        std::remove(endpoints_path.c_str());
+
+        T median{};
+        std::ifstream sorted(sorted_path, std::ios::binary);
+        sorted.seekg((std::streamoff)(count * sizeof(T)));
+        ok &= (bool)sorted.read(reinterpret_cast<char *>(&median), sizeof(T));
+        sorted.close();
+        std::remove(sorted_path.c_str());
+        return median;
+    }
+
+    /// appends the columns of a center list stored in a file to the pools and deletes the file
+    void write_center(const std::string &center_path) {
+        for (bool by_start: {true, false}) {
+            std::string sorted_path = temp_path();
+            auto less = [by_start](const interval_type &a, const interval_type &b) {
+                return by_start ? a.start < b.start : a.end < b.end;
+            };
+            ok &= external_sort<interval_type>(center_path, sorted_path, less, memory_budget);
+
+            record_file::reader<interval_type> in(sorted_path);
+            for (interval_type i; in.next(i);) {
+                (by_start ? starts : ends).push(by_start ? i.start : i.end);
+                if constexpr (!std::is_void_v<P>)
+                    (by_start ? payloads_by_start : payloads_by_end).push(i.payload);
+            }
+            ok &= in.is_open() && !in.failed();
+            std::remove(sorted_path.c_str());
+        }
+        std::remove(center_path.c_str());
+    }
+
+    static int count_nodes(const interval_tree_node<T, P> *root) {
+        return root ? 1 + count_nodes(root->left_node.get()) + count_nodes(root->right_node.get()) : 0;
+    }
+
+    /// writes a tree built in memory in preorder
+    /// \return index of its root
+    int emit(const interval_tree_node<T, P> &cur) {
+        int index = (int)nodes.size();
+        node packed{cur.x_median, cur.low, cur.high, -1, -1,
+                    (int)starts.size(), (int)cur.starts.size(), cur.subtree_size};
+        if (cur.left_node)
+            packed.left_node = index + 1;
+        if (cur.right_node)
+            packed.right_node = index + 1 + count_nodes(cur.left_node.get());
+        nodes.push(packed);
+
+        for (size_t i = 0; i < cur.starts.size(); ++i) {
+            starts.push(cur.starts[i]);
+            ends.push(cur.ends[i]);
+            if constexpr (!std::is_void_v<P>) {
+                payloads_by_start.push(cur.payloads_by_start[i]);
+                payloads_by_end.push(cur.payloads_by_end[i]);
+            }
+        }
+
+        if (cur.left_node)
+            emit(*cur.left_node);
+        if (cur.right_node)
+            emit(*cur.right_node);
+        return index;
+    }
+
+    /// concatenates the node file and the pools into the index file behind its header
+    bool compose() {
+        using namespace interval_index_file;
+        header h = make_header<T, P>(nodes.size(), starts.size());
+        h.checksum = CHECKSUM_SEED;
+
+        // the header is written last, once the checksum is known
+        std::ofstream out(index_path, std::ios::binary | std::ios::trunc);
+        std::vector<unsigned char> pending(align(sizeof(header)), 0);
+        out.write(reinterpret_cast<const char *>(pending.data()), (std::streamsize)pending.size());
+        uint64_t written = pending.size();
+        pending.clear();
+
+        // sections are hashed in whole words on the way out, every one of them is padded to whole words
+        auto flush = [&](bool all) {
+            size_t bytes = all ? pending.size() : pending.size() / 8 * 8;
+            h.checksum = checksum(pending.data(), bytes, h.checksum);
+            out.write(reinterpret_cast<const char *>(pending.data()), (std::streamsize)bytes);
+            written += bytes;
+            pending.erase(pending.begin(), pending.begin() + bytes);
+        };
+        auto put = [&](const void *data, size_t bytes) {
+            auto from = static_cast<const unsigned char *>(data);
+            pending.insert(pending.end(), from, from + bytes);
+            if (pending.size() >= record_file::BLOCK_BYTES)
+                flush(false);
+        };
+        auto pad = [&]() {
+            static const unsigned char zeros[SECTION_ALIGNMENT] = {};
+            uint64_t size = written + pending.size();
+            put(zeros, align(size) - size);
+        };
+        auto copy = [&](const char *column, auto record) {
+            record_file::reader<decltype(record)> in(column_path(column));
+            while (in.next(record))
+                put(&record, sizeof(record));
+            pad();
+        };
+
+        std::sort(right_patches.begin(), right_patches.end());
+        record_file::reader<node> in(column_path("nodes"));
+        auto patch = right_patches.begin();
+        node cur;
+        for (size_t i = 0; in.next(cur); ++i) {
+            if (patch != right_patches.end() && patch->first == i)
+                cur.right_node = (patch++)->second;
+            put(&cur, sizeof(cur));
+        }
+        pad();
+        copy("starts", T());
+        copy("ends", T());
+        if constexpr (!std::is_void_v<P>) {
+            copy("payloads_by_start", payload_type());
+            copy("payloads_by_end", payload_type());
+        }
+        flush(true);
+
+        out.seekp(0);
+        out.write(reinterpret_cast<const char *>(&h), sizeof(h));
+        return out.flush() && written == h.file_size;
+    }
+};
+
+/// builds the index file of a file of interval<T, P> records in about memory_budget bytes of memory
+/// \return false if a file couldn't be read or written
+template <typename T = int, typename P = int>
+bool build_index_external(const std::string &intervals_path, const std::string &index_path, size_t memory_budget) {
+    return external_interval_builder<T, P>(index_path, memory_budget).build(intervals_path);
+}
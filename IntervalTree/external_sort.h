@@ -0,0 +1,215 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <queue>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/// Sequential access to files of fixed-size binary records, the unit of all external-memory passes.
+namespace record_file {
+    // records are moved to and from the disk in blocks of about this many bytes
+    constexpr size_t BLOCK_BYTES = 1 << 16;
+
+    template <typename R>
+    class reader {
+    private:
+        std::ifstream in;
+        std::vector<R> buffer;
+        size_t position = 0;
+
+    public:
+        explicit reader(const std::string &path, size_t block_records = BLOCK_BYTES / sizeof(R))
+                : in(path, std::ios::binary) {
+            static_assert(std::is_trivially_copyable_v<R>, "records are stored as raw bytes");
+            buffer.reserve(std::max<size_t>(1, block_records));
+        }
+
+        [[nodiscard]] bool is_open() const {
+            return in.is_open();
+        }
+
+        /// whether a read failed other than by reaching the end of the file
+        [[nodiscard]] bool failed() const {
+            return in.bad();
+        }
+
+        /// \return false at the end of the file
+        bool next(R &record) {
+            if (position == buffer.size()) {
+                buffer.resize(buffer.capacity());
+                in.read(reinterpret_cast<char *>(buffer.data()), (std::streamsize)(buffer.size() * sizeof(R)));
+                buffer.resize(in.gcount() / sizeof(R));
+                position = 0;
+                if (buffer.empty())
+                    return false;
+            }
+            record = buffer[position++];
+            return true;
+        }
+
+        /// reads up to count records into out
+        /// \return number of records read
+        size_t read(R *out, size_t count) {
+            size_t done = 0;
+            while (done < count && next(out[done]))
+                done++;
+            return done;
+        }
+    };
+
+    template <typename R>
+    class writer {
+    private:
+        std::ofstream out;
+        std::vector<R> buffer;
+        size_t written = 0;
+
+    public:
+        explicit writer(const std::string &path) : out(path, std::ios::binary | std::ios::trunc) {
+            static_assert(std::is_trivially_copyable_v<R>, "records are stored as raw bytes");
+            buffer.reserve(std::max<size_t>(1, BLOCK_BYTES / sizeof(R)));
+        }
+
+        void push(const R &record) {
+            buffer.push_back(record);
+            written++;
+            if (buffer.size() == buffer.capacity())
+                flush();
+        }
+
+        void flush() {
+            out.write(reinterpret_cast<const char *>(buffer.data()), (std::streamsize)(buffer.size() * sizeof(R)));
+            buffer.clear();
+        }
+
+        /// number of records pushed so far
+        [[nodiscard]] size_t size() const {
+            return written;
+        }
+
+        /// flushes and closes the file
+        /// \return false if anything failed to be written
+        bool close() {
+            flush();
+            out.close();
+            return !out.fail();
+        }
+    };
+}
+
+namespace record_file {
+    // at most this many runs are merged at once, which bounds the open files of a merge
+    constexpr size_t MAX_MERGE_FAN_IN = 64;
+    // a run being merged gets a read buffer of at least this many bytes
+    constexpr size_t MIN_MERGE_BLOCK_BYTES = 1 << 12;
+
+    /// k-way merge of sorted files into one
+    /// \param block_records read buffer of every input, in records
+    /// \return false if an input couldn't be opened or read or the output couldn't be written
+    template <typename R, typename Less>
+    bool merge(const std::vector<std::string> &inputs, const std::string &output, Less less, size_t block_records) {
+        std::vector<std::unique_ptr<reader<R>>> readers;
+        for (const auto &path: inputs) {
+            readers.push_back(std::make_unique<reader<R>>(path, block_records));
+            if (!readers.back()->is_open())
+                return false;
+        }
+
+        // min-heap of the current head of every input
+        auto greater = [&less](const std::pair<R, size_t> &a, const std::pair<R, size_t> &b) {
+            return less(b.first, a.first);
+        };
+        std::priority_queue<std::pair<R, size_t>, std::vector<std::pair<R, size_t>>, decltype(greater)> heads(greater);
+        for (size_t i = 0; i < readers.size(); ++i) {
+            R record;
+            if (readers[i]->next(record))
+                heads.emplace(record, i);
+        }
+
+        writer<R> out(output);
+        while (!heads.empty()) {
+            auto [record, from] = heads.top();
+            heads.pop();
+            out.push(record);
+            if (readers[from]->next(record))
+                heads.emplace(record, from);
+        }
+
+        bool ok = out.close();
+        for (const auto &in: readers)
+            ok &= !in->failed();
+        return ok;
+    }
+}
+
+/// Sorts a file of binary records using about memory_budget bytes: sorted runs that fit the budget
+/// are written to temporary files next to the output and merged in passes of a bounded fan-in, so the
+/// open files and the read buffers of a merge stay within the budget however many runs there are.
+/// \param input file to sort, left untouched
+/// \param output sorted file, may not be the input
+/// \param less strict weak ordering of the records
+/// \return false if a file couldn't be read or written
+template <typename R, typename Less>
+bool external_sort(const std::string &input, const std::string &output, Less less, size_t memory_budget) {
+    record_file::reader<R> in(input);
+    if (!in.is_open())
+        return false;
+
+    // sorted runs of at most run_size records
+    std::vector<std::string> runs;
+    size_t next_run = 0;
+    auto run_path = [&] {
+        return output + ".run" + std::to_string(next_run++);
+    };
+    auto remove_runs = [&] {
+        for (const auto &path: runs)
+            std::remove(path.c_str());
+    };
+
+    size_t run_size = std::max<size_t>(1, memory_budget / sizeof(R));
+    std::vector<R> run(run_size);
+    bool ok = true;
+    for (size_t got; ok && (got = in.read(run.data(), run_size)) != 0;) {
+        std::sort(run.begin(), run.begin() + got, less);
+        runs.push_back(run_path());
+        record_file::writer<R> out(runs.back());
+        for (size_t i = 0; i < got; ++i)
+            out.push(run[i]);
+        ok &= out.close();
+    }
+    ok &= !in.failed();
+    run = std::vector<R>();
+    if (!ok) {
+        remove_runs();
+        return false;
+    }
+
+    // every run of a merge gets an equal share of the budget as its read buffer
+    size_t fan_in = std::clamp<size_t>(memory_budget / record_file::MIN_MERGE_BLOCK_BYTES, 2,
+                                       record_file::MAX_MERGE_FAN_IN);
+    size_t block_records = std::max<size_t>(1, memory_budget / sizeof(R) / fan_in);
+
+    while (runs.size() > fan_in) {
+        std::vector<std::string> merged;
+        for (size_t first = 0; first < runs.size() && ok; first += fan_in) {
+            std::vector<std::string> group(runs.begin() + first,
+                                           runs.begin() + std::min(runs.size(), first + fan_in));
+            merged.push_back(run_path());
+            ok &= record_file::merge<R>(group, merged.back(), less, block_records);
+        }
+        remove_runs();
+        runs = std::move(merged);
+        if (!ok) {
+            remove_runs();
+            return false;
+        }
+    }
+
+    ok &= record_file::merge<R>(runs, output, less, block_records);
+    remove_runs();
+    return ok;
+}
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <vector>
+#include <queue>
+
+#include "interval_tree_node.h"
+
+/// node of the packed tree, coordinates go first so for 32-bit coordinates it is eight tightly packed words
+template <typename T>
+struct flat_interval_node {
+    T x_median;
+    T low, high; // minimal start and maximal end in the subtree
+    int left_node, right_node; // indices in nodes, -1 if there is no child
+    int center_begin, center_size; // range of the node in the center pools
+    int subtree_size;
+};
+
+static_assert(sizeof(flat_interval_node<int32_t>) == 32, "32-bit nodes must stay eight words");
+
+/// Read-only queries over a packed tree wherever its arrays live: in a flat_interval_tree
+/// or in a mapped index file. Nodes are stored in BFS order and refer to their children by index,
+/// center lists of all nodes live in shared column pools and are referenced by offsets.
+template <typename T = int, typename P = int>
+struct flat_interval_view {
+    using node = flat_interval_node<T>;
+    using payload_type = stored_payload_t<P>;
+    using span_type = interval_span<payload_type>;
+
+    const node *nodes = nullptr;
+    size_t node_count = 0;
+    // pooled center lists of all nodes, see interval_tree_node; payload pools are null for bare intervals
+    const T *starts = nullptr, *ends = nullptr;
+    const payload_type *payloads_by_start = nullptr, *payloads_by_end = nullptr;
+    size_t center_count = 0; // total number of intervals
+
+    /// number of intervals containing the point
+    [[nodiscard]] int get_numb_of_intervals(T point) const {
+        int result = 0;
+
+        for (int i = node_count ? 0 : -1; i != -1;) {
+            const node &cur = nodes[i];
+            result += center(cur).count_containing(point, cur.x_median);
+
+            if (point < cur.x_median)
+                i = cur.left_node;
+            else if (point > cur.x_median)
+                i = cur.right_node;
+            else
+                i = -1;
+        }
+
+        return result;
+    }
+
+    /// payloads of all intervals containing the point without copying them
+    /// \return one span per node on the search path that has matches
+    [[nodiscard]] std::vector<span_type> get_intervals(T point) const {
+        static_assert(!std::is_void_v<P>, "reporting identifies intervals by their payloads");
+        std::vector<span_type> result;
+
+        for (int i = node_count ? 0 : -1; i != -1;) {
+            const node &cur = nodes[i];
+            auto matches = center(cur).containing(point, cur.x_median);
+            if (matches.size() != 0)
+                result.push_back(matches);
+
+            if (point < cur.x_median)
+                i = cur.left_node;
+            else if (point > cur.x_median)
+                i = cur.right_node;
+            else
+                i = -1;
+        }
+
+        return result;
+    }
+
+    /// number of intervals overlapping [left, right]
+    [[nodiscard]] int get_numb_of_intervals(T left, T right) const {
+        int result = 0;
+        std::vector<int> pending;
+        if (node_count)
+            pending.push_back(0);
+
+        while (!pending.empty()) {
+            const node &cur = nodes[pending.back()];
+            pending.pop_back();
+
+            if (cur.high < left || cur.low > right)
+                continue;
+            if (left <= cur.low && cur.high <= right) {
+                result += cur.subtree_size;
+                continue;
+            }
+
+            result += center(cur).count_overlapping(left, right, cur.x_median);
+            if (cur.left_node != -1 && left < cur.x_median)
+                pending.push_back(cur.left_node);
+            if (cur.right_node != -1 && right > cur.x_median)
+                pending.push_back(cur.right_node);
+        }
+
+        return result;
+    }
+
+    /// payloads of all intervals overlapping [left, right] without copying them
+    [[nodiscard]] std::vector<span_type> get_intervals(T left, T right) const {
+        static_assert(!std::is_void_v<P>, "reporting identifies intervals by their payloads");
+        std::vector<span_type> result;
+        std::vector<int> pending;
+        if (node_count)
+            pending.push_back(0);
+
+        while (!pending.empty()) {
+            const node &cur = nodes[pending.back()];
+            pending.pop_back();
+
+            if (cur.high < left || cur.low > right)
+                continue;
+
+            auto matches = center(cur).overlapping(left, right, cur.x_median);
+            if (matches.size() != 0)
+                result.push_back(matches);
+            if (cur.left_node != -1 && left < cur.x_median)
+                pending.push_back(cur.left_node);
+            if (cur.right_node != -1 && right > cur.x_median)
+                pending.push_back(cur.right_node);
+        }
+
+        return result;
+    }
+
+private:
+    [[nodiscard]] center_view<T, P> center(const node &cur) const {
+        // payload pools are null for bare intervals, their pointers are never dereferenced then
+        return {starts + cur.center_begin, ends + cur.center_begin,
+                payloads_by_start ? payloads_by_start + cur.center_begin : nullptr,
+                payloads_by_end ? payloads_by_end + cur.center_begin : nullptr,
+                (size_t)cur.center_size};
+    }
+};
+
+/// Static interval tree packed into contiguous arrays owned by the tree itself.
+template <typename T = int, typename P = int>
+struct flat_interval_tree {
+    using node = flat_interval_node<T>;
+    using payload_type = stored_payload_t<P>;
+    using span_type = interval_span<payload_type>;
+
+    std::vector<node> nodes;
+    std::vector<T> starts, ends;
+    std::vector<payload_type> payloads_by_start, payloads_by_end;
+
+    /// packs an already built pointer-based tree
+    /// \param root root of the tree built by interval_tree_node
+    explicit flat_interval_tree(const interval_tree_node<T, P> &root) {
+        std::queue<const interval_tree_node<T, P> *> order;
+        order.push(&root);
+
+        // children are numbered in the order they are pushed, so the index of a child
+        // is known before the child itself is written
+        int next_index = 1;
+        while (!order.empty()) {
+            const interval_tree_node<T, P> *cur = order.front();
+            order.pop();
+
+            node packed{cur->x_median, cur->low, cur->high, -1, -1,
+                        (int)starts.size(), (int)cur->starts.size(), cur->subtree_size};
+            if (cur->left_node) {
+                packed.left_node = next_index++;
+                order.push(cur->left_node.get());
+            }
+            if (cur->right_node) {
+                packed.right_node = next_index++;
+                order.push(cur->right_node.get());
+            }
+
+            nodes.push_back(packed);
+            starts.insert(starts.end(), cur->starts.begin(), cur->starts.end());
+            ends.insert(ends.end(), cur->ends.begin(), cur->ends.end());
+            payloads_by_start.insert(payloads_by_start.end(), cur->payloads_by_start.begin(), cur->payloads_by_start.end());
+            payloads_by_end.insert(payloads_by_end.end(), cur->payloads_by_end.begin(), cur->payloads_by_end.end());
+        }
+    }
+
+    [[nodiscard]] flat_interval_view<T, P> view() const {
+        return {nodes.data(), nodes.size(), starts.data(), ends.data(),
+                payloads_by_start.empty() ? nullptr : payloads_by_start.data(),
+                payloads_by_end.empty() ? nullptr : payloads_by_end.data(), starts.size()};
+    }
+
+    /// number of intervals containing the point
+    [[nodiscard]] int get_numb_of_intervals(T point) const {
+        return view().get_numb_of_intervals(point);
+    }
+
+    /// payloads of all intervals containing the point without copying them
+    [[nodiscard]] std::vector<span_type> get_intervals(T point) const {
+        return view().get_intervals(point);
+    }
+
+    /// number of intervals overlapping [left, right]
+    [[nodiscard]] int get_numb_of_intervals(T left, T right) const {
+        return view().get_numb_of_intervals(left, right);
+    }
+
+    /// payloads of all intervals overlapping [left, right] without copying them
+    [[nodiscard]] std::vector<span_type> get_intervals(T left, T right) const {
+        return view().get_intervals(left, right);
+    }
+};
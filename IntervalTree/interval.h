@@ -0,0 +1,96 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+/// closed interval [start, end] carrying a payload of the caller's choice (an id by default)
+/// \tparam T coordinate type, any type with a total order
+/// \tparam P payload type, void for bare intervals
+template <typename T = int, typename P = int>
+struct interval {
+    T start, end;
+    P payload;
+};
+
+template <typename T>
+struct interval<T, void> {
+    T start, end;
+};
+
+static_assert(sizeof(interval<int32_t, void>) == 8, "bare 32-bit intervals must stay two words");
+static_assert(sizeof(interval<int32_t, int32_t>) == 12, "32-bit intervals with an id must stay three words");
+
+template <typename T, typename P>
+bool operator==(const interval<T, P> &a, const interval<T, P> &b) {
+    if constexpr (std::is_void_v<P>)
+        return a.start == b.start && a.end == b.end;
+    else
+        return a.start == b.start && a.end == b.end && a.payload == b.payload;
+}
+
+/// payload type as it is stored in the trees, bare intervals keep an empty placeholder
+struct no_payload {};
+
+template <typename P>
+using stored_payload_t = std::conditional_t<std::is_void_v<P>, no_payload, P>;
+
+/// contiguous run of matched intervals seen through their payloads, valid while the tree is alive
+template <typename E>
+struct interval_span {
+    const E *first = nullptr, *last = nullptr;
+
+    [[nodiscard]] const E *begin() const { return first; }
+
+    [[nodiscard]] const E *end() const { return last; }
+
+    [[nodiscard]] size_t size() const { return last - first; }
+};
+
+/// sorts [first, last) by start or by end, LSD radix sort for integral coordinates
+template <typename I>
+void sort_intervals(I *first, I *last, bool by_start) {
+    // ranges smaller than this are sorted with std::sort, radix passes don't pay off on them
+    constexpr size_t RADIX_SORT_THRESHOLD = 256;
+    using T = decltype(I::start);
+    size_t n = last - first;
+
+    if constexpr (std::is_integral_v<T>) {
+        using U = std::make_unsigned_t<T>;
+        auto key = [by_start](const I &i) {
+            U k = by_start ? i.start : i.end;
+            // flipping the sign bit orders negative numbers before positive ones
+            if constexpr (std::is_signed_v<T>)
+                k ^= (U)1 << (sizeof(U) * 8 - 1);
+            return k;
+        };
+
+        if (n >= RADIX_SORT_THRESHOLD) {
+            // one byte per pass, the data bounces between the range and the buffer
+            std::vector<I> buffer(n);
+            I *from = first, *to = buffer.data();
+            for (size_t shift = 0; shift < sizeof(U) * 8; shift += 8) {
+                size_t counts[257] = {};
+                for (size_t i = 0; i < n; ++i)
+                    counts[((key(from[i]) >> shift) & 0xFF) + 1]++;
+                if (counts[((key(from[0]) >> shift) & 0xFF) + 1] == n)
+                    continue; // every key has the same byte here
+                for (int b = 0; b < 256; ++b)
+                    counts[b + 1] += counts[b];
+                for (size_t i = 0; i < n; ++i)
+                    to[counts[(key(from[i]) >> shift) & 0xFF]++] = from[i];
+                std::swap(from, to);
+            }
+            if (from != first)
+                std::copy(from, from + n, first);
+            return;
+        }
+    }
+
+    std::sort(first, last, [by_start](const I &a, const I &b) {
+        return by_start ? a.start < b.start : a.end < b.end;
+    });
+}
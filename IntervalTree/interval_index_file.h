@@ -0,0 +1,212 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "flat_interval_tree.h"
+
+/// On-disk layout of a flat_interval_tree: a fixed header followed by the node array and the
+/// center pools, every section aligned to 64 bytes. Nodes refer to each other and to the pools
+/// by index only, so the file is used in place wherever it is mapped.
+namespace interval_index_file {
+    constexpr char MAGIC[8] = {'I', 'T', 'R', 'E', 'E', 'I', 'D', 'X'};
+    constexpr uint32_t VERSION = 1;
+    // reads back as 0x04030201 on a machine of the other byte order
+    constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+    constexpr uint64_t SECTION_ALIGNMENT = 64;
+
+    struct header {
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order;
+        // layout of the stored types, a file is only opened with the same instantiation it was written with
+        uint8_t coordinate_size, coordinate_is_float, coordinate_is_signed, has_payloads;
+        uint32_t payload_size;
+        uint32_t node_size;
+        uint32_t reserved;
+        uint64_t node_count, center_count;
+        // section offsets from the beginning of the file, payload offsets are 0 for bare intervals
+        uint64_t nodes_offset, starts_offset, ends_offset, payloads_by_start_offset, payloads_by_end_offset;
+        uint64_t file_size;
+        uint64_t checksum; // of everything after the header
+    };
+
+    static_assert(sizeof(header) % 8 == 0, "the checksummed part must start on a word boundary");
+
+    inline uint64_t align(uint64_t offset) {
+        return (offset + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+    }
+
+    constexpr uint64_t CHECKSUM_SEED = 0x9E3779B97F4A7C15ull;
+
+    /// 64-bit multiply-xor hash over 8-byte words, size has to be a multiple of 8
+    /// \param h hash of the preceding bytes when the data is hashed piece by piece
+    inline uint64_t checksum(const unsigned char *data, uint64_t size, uint64_t h = CHECKSUM_SEED) {
+        for (uint64_t i = 0; i < size; i += 8) {
+            uint64_t word;
+            std::memcpy(&word, data + i, 8);
+            h = (h ^ word) * 0xFF51AFD7ED558CCDull;
+            h ^= h >> 32;
+        }
+        return h;
+    }
+
+    template <typename T, typename P>
+    header make_header(uint64_t node_count, uint64_t center_count) {
+        header h{};
+        std::memcpy(h.magic, MAGIC, sizeof(MAGIC));
+        h.version = VERSION;
+        h.byte_order = BYTE_ORDER_MARK;
+        h.coordinate_size = sizeof(T);
+        h.coordinate_is_float = std::is_floating_point_v<T>;
+        h.coordinate_is_signed = std::is_signed_v<T>;
+        h.has_payloads = !std::is_void_v<P>;
+        h.payload_size = std::is_void_v<P> ? 0 : sizeof(stored_payload_t<P>);
+        h.node_size = sizeof(flat_interval_node<T>);
+        h.node_count = node_count;
+        h.center_count = center_count;
+
+        uint64_t offset = align(sizeof(header));
+        auto place = [&offset](uint64_t bytes) {
+            uint64_t at = offset;
+            offset = align(offset + bytes);
+            return at;
+        };
+        h.nodes_offset = place(node_count * h.node_size);
+        h.starts_offset = place(center_count * sizeof(T));
+        h.ends_offset = place(center_count * sizeof(T));
+        if (h.has_payloads) {
+            h.payloads_by_start_offset = place(center_count * h.payload_size);
+            h.payloads_by_end_offset = place(center_count * h.payload_size);
+        }
+        h.file_size = offset;
+        return h;
+    }
+}
+
+/// writes the tree in the index file format
+/// \return false if the file couldn't be written
+template <typename T, typename P>
+bool write_index(const flat_interval_tree<T, P> &tree, const std::string &path) {
+    static_assert(std::is_trivially_copyable_v<T> && std::is_trivially_copyable_v<stored_payload_t<P>>,
+                  "only trivially copyable coordinates and payloads can be stored");
+    using namespace interval_index_file;
+
+    header h = make_header<T, P>(tree.nodes.size(), tree.starts.size());
+
+    // the image is assembled in memory first, the checksum needs all of it anyway
+    std::vector<unsigned char> image(h.file_size, 0);
+    auto put = [&image](uint64_t offset, const void *data, size_t bytes) {
+        if (bytes)
+            std::memcpy(image.data() + offset, data, bytes);
+    };
+    put(h.nodes_offset, tree.nodes.data(), tree.nodes.size() * h.node_size);
+    put(h.starts_offset, tree.starts.data(), tree.starts.size() * sizeof(T));
+    put(h.ends_offset, tree.ends.data(), tree.ends.size() * sizeof(T));
+    if (h.has_payloads) {
+        put(h.payloads_by_start_offset, tree.payloads_by_start.data(), tree.payloads_by_start.size() * h.payload_size);
+        put(h.payloads_by_end_offset, tree.payloads_by_end.data(), tree.payloads_by_end.size() * h.payload_size);
+    }
+    h.checksum = checksum(image.data() + align(sizeof(header)), h.file_size - align(sizeof(header)));
+    put(0, &h, sizeof(h));
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char *>(image.data()), (std::streamsize)image.size());
+    return (bool)out.flush();
+}
+
+/// Read-only interval index mapped straight from a file written by write_index.
+/// Opening does no parsing and no allocation: the pages are shared with every other process
+/// mapping the same file and are loaded lazily by the queries touching them.
+template <typename T = int, typename P = int>
+class mapped_interval_tree {
+private:
+    void *data = nullptr;
+    size_t size = 0;
+    flat_interval_view<T, P> tree;
+
+    mapped_interval_tree(void *data, size_t size) : data(data), size(size) {}
+
+public:
+    mapped_interval_tree(const mapped_interval_tree &) = delete;
+
+    mapped_interval_tree &operator=(const mapped_interval_tree &) = delete;
+
+    mapped_interval_tree(mapped_interval_tree &&other) noexcept
+            : data(other.data), size(other.size), tree(other.tree) {
+        other.data = nullptr;
+        other.size = 0;
+    }
+
+    mapped_interval_tree &operator=(mapped_interval_tree &&other) noexcept {
+        std::swap(data, other.data);
+        std::swap(size, other.size);
+        std::swap(tree, other.tree);
+        return *this;
+    }
+
+    virtual ~mapped_interval_tree() {
+        if (data)
+            munmap(data, size);
+    }
+
+    /// maps an index file
+    /// \param path file written by write_index with the same T and P
+    /// \param verify_checksum whether to hash the whole file, which reads every page of it; off by default
+    /// so that opening only touches the header, meant for an offline check of a file
+    /// \return nothing if the file can't be mapped, is damaged or was written for other types
+    static std::optional<mapped_interval_tree> open(const std::string &path, bool verify_checksum = false) {
+        using namespace interval_index_file;
+
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd == -1)
+            return std::nullopt;
+        struct stat st{};
+        if (fstat(fd, &st) != 0 || (uint64_t)st.st_size < align(sizeof(header))) {
+            ::close(fd);
+            return std::nullopt;
+        }
+        void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        // the mapping keeps the file alive on its own
+        ::close(fd);
+        if (data == MAP_FAILED)
+            return std::nullopt;
+
+        mapped_interval_tree result(data, st.st_size);
+        const auto *bytes = static_cast<const unsigned char *>(data);
+        header h{};
+        std::memcpy(&h, bytes, sizeof(h));
+
+        header expected = make_header<T, P>(h.node_count, h.center_count);
+        expected.checksum = h.checksum;
+        if (std::memcmp(&h, &expected, sizeof(h)) != 0 || h.file_size != (uint64_t)st.st_size)
+            return std::nullopt;
+        if (verify_checksum && checksum(bytes + align(sizeof(header)), h.file_size - align(sizeof(header))) != h.checksum)
+            return std::nullopt;
+
+        auto &view = result.tree;
+        view.nodes = reinterpret_cast<const flat_interval_node<T> *>(bytes + h.nodes_offset);
+        view.node_count = h.node_count;
+        view.starts = reinterpret_cast<const T *>(bytes + h.starts_offset);
+        view.ends = reinterpret_cast<const T *>(bytes + h.ends_offset);
+        if (h.has_payloads) {
+            view.payloads_by_start = reinterpret_cast<const stored_payload_t<P> *>(bytes + h.payloads_by_start_offset);
+            view.payloads_by_end = reinterpret_cast<const stored_payload_t<P> *>(bytes + h.payloads_by_end_offset);
+        }
+        view.center_count = h.center_count;
+        return result;
+    }
+
+    [[nodiscard]] const flat_interval_view<T, P> &view() const {
+        return tree;
+    }
+};
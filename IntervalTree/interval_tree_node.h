@@ -1,13 +1,289 @@
+#pragma once
+
 #include <vector>
+#include <limits>
+#include <algorithm>
+#include <future>
+#include <memory>
+#include <thread>
+
+#include "interval.h"
+#include "center_list.h"
+
+/// shape of a built tree, to check the query cost on real data
+struct interval_tree_stats {
+    int depth = 0; // number of levels
+    int node_count = 0;
+    size_t max_center_size = 0;
+    double average_center_size = 0;
+    /// center_size_histogram[b] - number of nodes whose center list size is in [2^(b-1), 2^b), b = 0 for empty ones
+    std::vector<int> center_size_histogram;
+};
 
+/// \tparam T coordinate type
+/// \tparam P payload type of the stored intervals, void for bare intervals
+template <typename T = int, typename P = int>
 struct interval_tree_node {
-    static constexpr int MAX_X = 1'000'000'000, MIN_X = 0;
-    interval_tree_node *left_node, *right_node;
-    int x_median;
-    std::vector<std::pair<int, int>> left_intervals, right_intervals;
+    using interval_type = interval<T, P>;
+    using payload_type = stored_payload_t<P>;
+    using span_type = interval_span<payload_type>;
 
-    interval_tree_node(const std::vector<std::pair<int, int>> &intervals, int x_m);
+    static constexpr T MAX_X = std::numeric_limits<T>::max(), MIN_X = std::numeric_limits<T>::lowest();
+    std::unique_ptr<interval_tree_node> left_node, right_node;
+    T x_median;
+    T low, high; // minimal start and maximal end in the subtree
+    int subtree_size; // number of intervals in the subtree
+    // center list as structure of arrays: sorted starts and sorted ends with their payloads,
+    // payload vectors stay empty for bare intervals
+    std::vector<T> starts, ends;
+    std::vector<payload_type> payloads_by_start, payloads_by_end;
 
-    int get_numb_of_intervals(int point);
-};
+    /// builds the tree splitting every node at the median endpoint of its intervals,
+    /// so each child gets at most half of them and the depth is at most log2(n) + 1;
+    /// the payload of every interval is its index in the input
+    explicit interval_tree_node(const std::vector<std::pair<T, T>> &intervals)
+            : interval_tree_node(with_ids(intervals)) {}
+
+    explicit interval_tree_node(const std::vector<interval_type> &intervals) {
+        build_root(intervals, nullptr);
+    }
+
+    /// same, but the root is split at x_m chosen by the caller
+    interval_tree_node(const std::vector<std::pair<T, T>> &intervals, T x_m)
+            : interval_tree_node(with_ids(intervals), x_m) {}
+
+    interval_tree_node(const std::vector<interval_type> &intervals, T x_m) {
+        build_root(intervals, &x_m);
+    }
+
+    interval_tree_node(const interval_tree_node &) = delete;
+
+    interval_tree_node &operator=(const interval_tree_node &) = delete;
+
+    virtual ~interval_tree_node() = default;
+
+    [[nodiscard]] interval_tree_stats get_stats() const {
+        interval_tree_stats stats;
+        size_t total_center_size = 0;
+        std::vector<std::pair<const interval_tree_node *, int>> pending = {{this, 1}};
+
+        while (!pending.empty()) {
+            auto [cur, level] = pending.back();
+            pending.pop_back();
+
+            size_t size = cur->starts.size(), bucket = 0;
+            while (bucket < 64 && (size >> bucket) != 0)
+                bucket++;
+            if (stats.center_size_histogram.size() <= bucket)
+                stats.center_size_histogram.resize(bucket + 1);
+            stats.center_size_histogram[bucket]++;
+
+            stats.depth = std::max(stats.depth, level);
+            stats.node_count++;
+            stats.max_center_size = std::max(stats.max_center_size, size);
+            total_center_size += size;
+
+            if (cur->left_node)
+                pending.emplace_back(cur->left_node.get(), level + 1);
+            if (cur->right_node)
+                pending.emplace_back(cur->right_node.get(), level + 1);
+        }
+        stats.average_center_size = (double)total_center_size / stats.node_count;
+
+        return stats;
+    }
+
+    /// number of intervals containing the point, O(log^2 n)
+    [[nodiscard]] int get_numb_of_intervals(T point) const {
+        int result = center().count_containing(point, x_median);
+
+        if (point < x_median && left_node)
+            result += left_node->get_numb_of_intervals(point);
+        else if (point > x_median && right_node)
+            result += right_node->get_numb_of_intervals(point);
+
+        return result;
+    }
+
+    /// payloads of all intervals containing the point without copying them
+    /// \return one span per node on the search path that has matches
+    [[nodiscard]] std::vector<span_type> get_intervals(T point) const {
+        static_assert(!std::is_void_v<P>, "reporting identifies intervals by their payloads");
+        std::vector<span_type> result;
+        for (auto cur = this; cur;) {
+            auto matches = cur->center().containing(point, cur->x_median);
+            if (matches.size() != 0)
+                result.push_back(matches);
+
+            if (point < cur->x_median)
+                cur = cur->left_node.get();
+            else if (point > cur->x_median)
+                cur = cur->right_node.get();
+            else
+                cur = nullptr;
+        }
+
+        return result;
+    }
+
+    /// number of intervals overlapping [left, right], O(log^2 n)
+    [[nodiscard]] int get_numb_of_intervals(T left, T right) const {
+        if (high < left || low > right)
+            return 0;
+        if (left <= low && high <= right)
+            return subtree_size; // every interval of the subtree overlaps the range
 
+        int result = center().count_overlapping(left, right, x_median);
+        if (left_node && left < x_median)
+            result += left_node->get_numb_of_intervals(left, right);
+        if (right_node && right > x_median)
+            result += right_node->get_numb_of_intervals(left, right);
+
+        return result;
+    }
+
+    /// payloads of all intervals overlapping [left, right] without copying them, O(log n + output)
+    [[nodiscard]] std::vector<span_type> get_intervals(T left, T right) const {
+        static_assert(!std::is_void_v<P>, "reporting identifies intervals by their payloads");
+        std::vector<span_type> result;
+        collect_overlaps(left, right, result);
+        return result;
+    }
+
+private:
+    // subtrees with fewer intervals than this are built in the calling thread
+    static constexpr size_t PARALLEL_BUILD_THRESHOLD = 1 << 15;
+
+    /// state shared by all nodes of one build
+    struct build_context {
+        interval_type *base; // start of the interval buffer
+        T *scratch; // two slots per interval, slices of disjoint subtrees don't overlap
+    };
+
+    interval_tree_node(interval_type *begin, interval_type *end, T x_m, build_context ctx, int parallel_depth) {
+        build(begin, end, x_m, ctx, parallel_depth);
+    }
+
+    static std::vector<interval_type> with_ids(const std::vector<std::pair<T, T>> &intervals) {
+        std::vector<interval_type> result;
+        result.reserve(intervals.size());
+        for (const auto &i: intervals) {
+            if constexpr (std::is_void_v<P>)
+                result.push_back({i.first, i.second});
+            else
+                result.push_back({i.first, i.second, (P)result.size()});
+        }
+
+        return result;
+    }
+
+    void build_root(const std::vector<interval_type> &intervals, const T *x_m) {
+        // the only copy of the input, every level partitions its own part of it in place
+        std::vector<interval_type> buffer(intervals);
+        std::vector<T> scratch(2 * buffer.size());
+        build_context ctx{buffer.data(), scratch.data()};
+
+        unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+        int parallel_depth = 0;
+        while ((1u << parallel_depth) < threads)
+            parallel_depth++;
+
+        auto begin = buffer.data(), end = buffer.data() + buffer.size();
+        build(begin, end, x_m ? *x_m : median_endpoint(begin, end, ctx), ctx, parallel_depth);
+    }
+
+    /// median of the 2n endpoints of [begin, end): at most n endpoints lie strictly on either side of it,
+    /// and an interval misses it only with both endpoints on one side
+    static T median_endpoint(interval_type *begin, interval_type *end, build_context ctx) {
+        if (begin == end)
+            return T();
+
+        T *first = ctx.scratch + 2 * (begin - ctx.base), *last = first;
+        for (auto i = begin; i != end; ++i) {
+            *last++ = i->start;
+            *last++ = i->end;
+        }
+        T *mid = first + (end - begin);
+        std::nth_element(first, mid, last);
+        return *mid;
+    }
+
+    /// partitions [begin, end) in place around x_m and builds both subtrees on their parts
+    /// \param parallel_depth how many more levels may hand a subtree to another thread
+    void build(interval_type *begin, interval_type *end, T x_m, build_context ctx, int parallel_depth) {
+        x_median = x_m;
+        low = MAX_X;
+        high = MIN_X;
+        for (auto i = begin; i != end; ++i) {
+            low = std::min(low, i->start);
+            high = std::max(high, i->end);
+        }
+
+        // [begin, left_end) - to the left of the median, [left_end, center_end) - contain it, the rest - to the right
+        auto left_end = std::partition(begin, end, [this](const interval_type &i) { return i.end < x_median; });
+        auto center_end = std::partition(left_end, end, [this](const interval_type &i) { return i.start <= x_median; });
+
+        // the center part of the buffer is sorted in place twice, every column is read off once
+        size_t center_size = center_end - left_end;
+        starts.reserve(center_size);
+        ends.reserve(center_size);
+        sort_intervals(left_end, center_end, true);
+        for (auto i = left_end; i != center_end; ++i) {
+            starts.push_back(i->start);
+            if constexpr (!std::is_void_v<P>)
+                payloads_by_start.push_back(i->payload);
+        }
+        sort_intervals(left_end, center_end, false);
+        for (auto i = left_end; i != center_end; ++i) {
+            ends.push_back(i->end);
+            if constexpr (!std::is_void_v<P>)
+                payloads_by_end.push_back(i->payload);
+        }
+
+        subtree_size = end - begin;
+
+        auto build_child = [ctx, parallel_depth](interval_type *b, interval_type *e) {
+            return std::unique_ptr<interval_tree_node>(
+                    b == e ? nullptr : new interval_tree_node(b, e, median_endpoint(b, e, ctx), ctx, parallel_depth - 1));
+        };
+
+        // the two halves of the buffer don't overlap, so the subtrees can be built independently
+        if (parallel_depth > 0 && (size_t)(left_end - begin) >= PARALLEL_BUILD_THRESHOLD
+                && (size_t)(end - center_end) >= PARALLEL_BUILD_THRESHOLD) {
+            auto left_future = std::async(std::launch::async, build_child, begin, left_end);
+            right_node = build_child(center_end, end);
+            left_node = left_future.get();
+        } else {
+            left_node = build_child(begin, left_end);
+            right_node = build_child(center_end, end);
+        }
+    }
+
+    [[nodiscard]] center_view<T, P> center() const {
+        return {starts.data(), ends.data(), payloads_by_start.data(), payloads_by_end.data(), starts.size()};
+    }
+
+    void collect_overlaps(T left, T right, std::vector<span_type> &result) const {
+        if (high < left || low > right)
+            return;
+
+        auto matches = center().overlapping(left, right, x_median);
+        if (matches.size() != 0)
+            result.push_back(matches);
+
+        // apart from the search paths of left and right every entered subtree lies inside the range,
+        // so the walk is bounded by the depth plus the output
+        if (right < x_median) {
+            if (left_node)
+                left_node->collect_overlaps(left, right, result);
+        } else if (left > x_median) {
+            if (right_node)
+                right_node->collect_overlaps(left, right, result);
+        } else {
+            if (left_node)
+                left_node->collect_overlaps(left, right, result);
+            if (right_node)
+                right_node->collect_overlaps(left, right, result);
+        }
+    }
+};
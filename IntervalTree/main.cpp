@@ -1,31 +1,70 @@
 #include <iostream>
+#include <optional>
+#include <string>
 #include <vector>
 
 #include "interval_tree_node.h"
+#include "flat_interval_tree.h"
+#include "batch_query.h"
+#include "interval_index_file.h"
+#include "external_interval_builder.h"
 
 using namespace std;
 
 
 
-int main() {
-    int n, k, point, min_x = 1'000'000'000, max_x = 0;
-    cin >> n;
-    vector<pair<int, int>> intervals(n);
+// usage: IntervalTree [--write index | --read index | --verify index | --external intervals index budget_mb]
+// --write also stores the built tree, --read skips the intervals and queries a stored tree,
+// --verify checks the checksum of a stored tree, which --read leaves out to open it without reading it all,
+// --external builds the index of a binary file of interval<int, int> records within the memory budget and queries it
+int main(int argc, char **argv) {
+    string mode = argc >= 3 ? argv[1] : "", path = argc >= 3 ? argv[2] : "";
+    int n, k;
 
-    for (auto& i: intervals) {
-        cin >> i.first >> i.second;
-        if (i.first < min_x)
-            min_x = i.first;
-        if (i.second > max_x)
-            max_x = i.second;
+    if (mode == "--verify") {
+        bool intact = mapped_interval_tree<>::open(path, true).has_value();
+        cout << path << (intact ? " is intact" : " is damaged or can't be read") << '\n';
+        return intact ? 0 : 1;
+    }
+
+    if (mode == "--external") {
+        if (argc != 5 || !build_index_external(argv[2], argv[3], stoul(argv[4]) << 20)) {
+            cerr << "can't build index " << (argc > 3 ? argv[3] : "") << '\n';
+            return 1;
+        }
+        mode = "--read";
+        path = argv[3];
+    }
+
+    optional<mapped_interval_tree<>> mapped;
+    optional<flat_interval_tree<>> flat_tree;
+    if (mode == "--read") {
+        mapped = mapped_interval_tree<>::open(path);
+        if (!mapped) {
+            cerr << "can't open index " << path << '\n';
+            return 1;
+        }
+    } else {
+        cin >> n;
+        vector<pair<int, int>> intervals(n);
+
+        for (auto& i: intervals)
+            cin >> i.first >> i.second;
+        flat_tree.emplace(interval_tree_node<>(intervals));
+
+        if (mode == "--write" && !write_index(*flat_tree, path)) {
+            cerr << "can't write index " << path << '\n';
+            return 1;
+        }
     }
-    auto tree = new interval_tree_node(intervals, (min_x + max_x) / 2);
 
     cin >> k;
-    for (int i = 0; i < k; ++i) {
+    vector<int> points(k);
+    for (auto& point: points)
         cin >> point;
-        cout << tree->get_numb_of_intervals(point) << '\n';
-    }
+
+    for (int count: get_numb_of_intervals(mapped ? mapped->view() : flat_tree->view(), points))
+        cout << count << '\n';
 
     return 0;
 }
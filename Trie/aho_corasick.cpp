@@ -0,0 +1,148 @@
+#include "aho_corasick.h"
+
+#include <stdexcept>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+aho_corasick::builder::builder() {
+    states.push_back({0, 0, 0, NONE});
+}
+
+uint32_t aho_corasick::builder::add_state(uint32_t parent, uint8_t byte) {
+    states.push_back({parent, byte, states[parent].depth + 1, NONE});
+    return (uint32_t)states.size() - 1;
+}
+
+uint32_t aho_corasick::builder::mark_pattern(uint32_t state) {
+    states[state].pattern = (uint32_t)lengths.size();
+    lengths.push_back(states[state].depth);
+    return states[state].pattern;
+}
+
+aho_corasick aho_corasick::builder::finish() {
+    aho_corasick result;
+
+    // every byte of a pattern gets its own column, padded to an even count
+    bool used[256] = {};
+    for (size_t s = 1; s < states.size(); ++s)
+        used[states[s].byte] = true;
+    uint32_t columns = 1;
+    for (int b = 0; b < 256; ++b)
+        if (used[b])
+            result.classes[b] = (uint8_t)columns++;
+    columns += columns & 1;
+    if (states.size() * columns > UINT32_MAX / 2)
+        throw length_error("aho_corasick: transition table doesn't fit into 32-bit entries");
+    result.class_count = columns;
+
+    // the table holds state numbers until the end; the trie edges go in first, states are then completed
+    // in the order of their depth, so the failure state and its row are always done before the state itself
+    vector<uint32_t> &table = result.transitions;
+    table.assign(states.size() * columns, NONE);
+    for (uint32_t s = 1; s < states.size(); ++s)
+        table[states[s].parent * columns + result.classes[states[s].byte]] = s;
+
+    vector<uint32_t> order(states.size()), starts(states.size() + 1);
+    for (auto &added: states)
+        starts[added.depth + 1]++;
+    for (size_t d = 1; d < starts.size(); ++d)
+        starts[d] += starts[d - 1];
+    for (uint32_t s = 0; s < states.size(); ++s)
+        order[starts[states[s].depth]++] = s;
+
+    vector<uint32_t> failure(states.size(), 0);
+    result.patterns.resize(states.size());
+    result.outputs.assign(states.size(), NONE);
+    for (uint32_t s: order) {
+        const state &current = states[s];
+        uint32_t fail = 0;
+        if (current.depth > 1)
+            fail = table[failure[current.parent] * columns + result.classes[current.byte]];
+        failure[s] = fail;
+
+        for (uint32_t c = 0; c < columns; ++c) {
+            uint32_t &next = table[s * columns + c];
+            if (next == NONE)
+                next = s ? table[fail * columns + c] : 0;
+        }
+
+        result.patterns[s] = current.pattern;
+        if (s)
+            result.outputs[s] = result.patterns[fail] != NONE ? fail : result.outputs[fail];
+    }
+
+    // state numbers become entries
+    for (auto &next: table)
+        next = next * columns | (result.patterns[next] != NONE || result.outputs[next] != NONE);
+
+    if (states.size() > 1) {
+        for (int b = 0; b < 256; ++b)
+            if (result.classes[b] && table[result.classes[b]] != 0)
+                result.first_bytes.push_back((uint8_t)b);
+        if (result.first_bytes.size() > PREFILTER_BYTES)
+            result.first_bytes.clear();
+    }
+    result.lengths = move(lengths);
+    return result;
+}
+
+void aho_corasick::scan(const char *data, size_t size, stream_state &stream, vector<match> &out) const {
+    uint32_t entry = stream.entry;
+    bool prefilter = !first_bytes.empty();
+
+    for (size_t i = 0; i < size; ++i) {
+        if (entry == 0 && prefilter) {
+            i = skip(data, i, size);
+            if (i == size)
+                break;
+        }
+
+        entry = transitions[(entry & ~1u) + classes[(uint8_t)data[i]]];
+        if (!(entry & 1))
+            continue;
+
+        uint32_t state = entry / class_count;
+        if (patterns[state] == NONE)
+            state = outputs[state];
+        for (; state != NONE; state = outputs[state])
+            out.push_back({stream.offset + i + 1 - lengths[patterns[state]], patterns[state]});
+    }
+
+    stream.entry = entry;
+    stream.offset += size;
+}
+
+vector<aho_corasick::match> aho_corasick::scan(const string &text) const {
+    vector<match> result;
+    stream_state stream;
+    scan(text.data(), text.size(), stream, result);
+    return result;
+}
+
+size_t aho_corasick::skip(const char *data, size_t from, size_t size) const {
+#ifdef __SSE2__
+    // 16 bytes at a time against every first byte
+    __m128i bytes[PREFILTER_BYTES];
+    size_t count = first_bytes.size();
+    for (size_t i = 0; i < count; ++i)
+        bytes[i] = _mm_set1_epi8((char)first_bytes[i]);
+
+    for (; from + 16 <= size; from += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + from));
+        __m128i hits = _mm_cmpeq_epi8(chunk, bytes[0]);
+        for (size_t i = 1; i < count; ++i)
+            hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, bytes[i]));
+        int mask = _mm_movemask_epi8(hits);
+        if (mask)
+            return from + __builtin_ctz(mask);
+    }
+#endif
+    for (; from < size; ++from)
+        if (transitions[classes[(uint8_t)data[from]]] != 0)
+            return from;
+    return size;
+}
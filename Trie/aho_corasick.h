@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// Multi-pattern matcher built from the words of a trie by trie::automaton, finds every occurrence
+/// of every pattern in one pass over the text. The failure links of Aho-Corasick are folded into a
+/// complete transition table, so every byte costs one table read. Bytes that occur in no pattern share
+/// one column of the table; between matches, text that can't start a pattern is skipped with SIMD
+/// compares when the patterns begin with only a few distinct bytes.
+class aho_corasick {
+public:
+    struct match {
+        size_t offset; // of the first byte of the occurrence, counted from the start of the stream
+        uint32_t pattern;
+    };
+
+    /// where a scan chunk by chunk has got to
+    struct stream_state {
+        uint32_t entry = 0; // transition that led to the current state, 0 - the root
+        size_t offset = 0; // bytes scanned so far
+    };
+
+    /// Takes the states of the pattern trie one by one, a parent before its children.
+    class builder {
+    public:
+        builder();
+
+        /// \return the new state reached from the parent by the byte, the root is state 0
+        uint32_t add_state(uint32_t parent, uint8_t byte);
+
+        /// marks a pattern ending in the state, the root can't end one
+        /// \return id of the pattern, ids are given in the order of the calls
+        uint32_t mark_pattern(uint32_t state);
+
+        aho_corasick finish();
+
+    private:
+        struct state {
+            uint32_t parent;
+            uint8_t byte;
+            uint32_t depth;
+            uint32_t pattern;
+        };
+
+        std::vector<state> states;
+        std::vector<uint32_t> lengths;
+    };
+
+    /// finds the patterns in a chunk of a stream and appends them to out in the order they end,
+    /// an occurrence may start in an earlier chunk
+    void scan(const char *data, size_t size, stream_state &stream, std::vector<match> &out) const;
+
+    /// all occurrences in the text, in the order they end
+    [[nodiscard]] std::vector<match> scan(const std::string &text) const;
+
+    /// number of patterns
+    [[nodiscard]] size_t size() const {
+        return lengths.size();
+    }
+
+    [[nodiscard]] uint32_t pattern_length(uint32_t pattern) const {
+        return lengths[pattern];
+    }
+
+    /// number of states, the root included
+    [[nodiscard]] size_t state_count() const {
+        return patterns.size();
+    }
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+    // the prefilter is used when the patterns start with at most this many distinct bytes
+    static constexpr size_t PREFILTER_BYTES = 8;
+
+    // entry = state * class_count, the lowest bit set if the state ends a pattern or has one on its
+    // failure chain; class_count is even, so the bit never collides with a row
+    std::vector<uint32_t> transitions;
+    uint32_t class_count = 0;
+    uint8_t classes[256] = {}; // column of every byte, 0 - the byte is in no pattern
+    std::vector<uint32_t> patterns; // pattern ending in the state or NONE
+    std::vector<uint32_t> outputs; // next state on the failure chain that ends a pattern or NONE
+    std::vector<uint32_t> lengths; // of the patterns
+    std::vector<uint8_t> first_bytes; // bytes a pattern starts with, empty if there are too many
+
+    aho_corasick() = default;
+
+    /// position of the first byte from which some pattern starts or size
+    [[nodiscard]] size_t skip(const char *data, size_t from, size_t size) const;
+};
@@ -0,0 +1,212 @@
+#include "concurrent_trie.h"
+
+#include <algorithm>
+#include <thread>
+
+using namespace std;
+
+namespace {
+    /// counter pair of the calling thread, threads are spread over the pairs round-robin
+    size_t thread_slot(size_t slots) {
+        static atomic<size_t> next_thread{0};
+        thread_local size_t slot = next_thread.fetch_add(1) % slots;
+        return slot;
+    }
+}
+
+concurrent_trie::read_guard::read_guard(const concurrent_trie &owner) {
+    auto &slot = owner.slots[thread_slot(READER_SLOTS)];
+    // count in the parity of the epoch that is current once the count is visible
+    while (true) {
+        uint64_t e = owner.epoch.load();
+        counter = &slot.active[e & 1];
+        counter->fetch_add(1);
+        if (owner.epoch.load() == e)
+            break;
+        counter->fetch_sub(1);
+    }
+}
+
+concurrent_trie::read_guard::~read_guard() {
+    counter->fetch_sub(1, memory_order_release);
+}
+
+concurrent_trie::concurrent_trie() : root(new node()) {}
+
+concurrent_trie::~concurrent_trie() {
+    for (auto table: retired)
+        destroy_table(table);
+
+    vector<node *> pending = {root};
+    while (!pending.empty()) {
+        node *cur = pending.back();
+        pending.pop_back();
+
+        child_table *table = cur->table.load();
+        if (table && table->dense) {
+            for (auto &child: static_cast<dense_table *>(table)->children)
+                if (node *c = child.load())
+                    pending.push_back(c);
+        } else if (table) {
+            auto small = static_cast<small_table *>(table);
+            pending.insert(pending.end(), small->children, small->children + small->count);
+        }
+        destroy_table(table);
+        delete cur;
+    }
+}
+
+concurrent_trie::node *concurrent_trie::find_child(const child_table *table, uint8_t byte) {
+    if (!table)
+        return nullptr;
+    if (table->dense)
+        return static_cast<const dense_table *>(table)->children[byte].load(memory_order_acquire);
+
+    auto small = static_cast<const small_table *>(table);
+    for (int i = 0; i < small->count; ++i)
+        if (small->keys[i] == byte)
+            return small->children[i];
+    return nullptr;
+}
+
+concurrent_trie::child_table *concurrent_trie::with_child(const child_table *table, uint8_t byte, node *child) {
+    auto small = static_cast<const small_table *>(table);
+    uint16_t count = table ? table->count : 0;
+
+    if (count < small_table::CAPACITY) {
+        auto result = new small_table();
+        result->count = count + 1;
+        result->dense = false;
+        int position = table ? upper_bound(small->keys, small->keys + count, byte) - small->keys : 0;
+        for (int i = 0, j = 0; i <= count; ++i) {
+            if (i == position) {
+                result->keys[i] = byte;
+                result->children[i] = child;
+            } else {
+                result->keys[i] = small->keys[j];
+                result->children[i] = small->children[j++];
+            }
+        }
+        return result;
+    }
+
+    auto result = new dense_table();
+    result->count = count + 1;
+    result->dense = true;
+    for (auto &slot: result->children)
+        slot.store(nullptr, memory_order_relaxed);
+    for (int i = 0; i < count; ++i)
+        result->children[small->keys[i]].store(small->children[i], memory_order_relaxed);
+    result->children[byte].store(child, memory_order_relaxed);
+    return result;
+}
+
+void concurrent_trie::destroy_table(child_table *table) {
+    if (table && table->dense)
+        delete static_cast<dense_table *>(table);
+    else
+        delete static_cast<small_table *>(table);
+}
+
+void concurrent_trie::insert(const string &word) {
+    vector<child_table *> replaced;
+    node *fresh = nullptr; // node made for the current byte, kept across retries until it is published
+
+    {
+        read_guard guard(*this);
+        node *iter = root;
+
+        for (const char& c: word) {
+            auto byte = (uint8_t)c;
+            node *child;
+
+            while (true) {
+                child_table *table = iter->table.load(memory_order_acquire);
+                child = find_child(table, byte);
+                if (child)
+                    break;
+                if (!fresh)
+                    fresh = new node();
+
+                if (table && table->dense) {
+                    // a dense table is filled in place, the loser of a race takes the winner's node
+                    node *expected = nullptr;
+                    auto &slot = static_cast<dense_table *>(table)->children[byte];
+                    if (slot.compare_exchange_strong(expected, fresh, memory_order_acq_rel)) {
+                        child = fresh;
+                        fresh = nullptr;
+                    } else {
+                        child = expected;
+                    }
+                    break;
+                }
+
+                // a small table is replaced as a whole, a lost race retries on the new table
+                child_table *replacement = with_child(table, byte, fresh);
+                if (iter->table.compare_exchange_strong(table, replacement, memory_order_acq_rel)) {
+                    if (table)
+                        replaced.push_back(table);
+                    child = fresh;
+                    fresh = nullptr;
+                    break;
+                }
+                destroy_table(replacement);
+            }
+
+            iter = child;
+        }
+
+        iter->is_word.store(true, memory_order_release);
+    }
+
+    // never published, nobody else has seen it
+    delete fresh;
+    if (!replaced.empty())
+        retire(replaced);
+}
+
+const concurrent_trie::node *concurrent_trie::find(const string &key) const {
+    const node *iter = root;
+
+    for (const char& c: key) {
+        iter = find_child(iter->table.load(memory_order_acquire), (uint8_t)c);
+        if (!iter)
+            return nullptr;
+    }
+
+    return iter;
+}
+
+bool concurrent_trie::search(const string &word) const {
+    read_guard guard(*this);
+    const node *found = find(word);
+    return found && found->is_word.load(memory_order_acquire);
+}
+
+bool concurrent_trie::starts_with(const string &prefix) const {
+    read_guard guard(*this);
+    return find(prefix) != nullptr;
+}
+
+void concurrent_trie::retire(vector<child_table *> &tables) {
+    lock_guard<mutex> lock(reclaim_mutex);
+    retired.insert(retired.end(), tables.begin(), tables.end());
+    if (retired.size() < RECLAIM_BATCH)
+        return;
+
+    synchronize();
+    for (auto table: retired)
+        destroy_table(table);
+    retired.clear();
+}
+
+void concurrent_trie::synchronize() {
+    // a reader may have read the epoch just before a flip and counted itself just after it,
+    // in the parity the first wait has already passed; the second flip waits for that parity again
+    for (int flip = 0; flip < 2; ++flip) {
+        uint64_t old = epoch.fetch_add(1);
+        for (auto &slot: slots)
+            while (slot.active[old & 1].load() != 0)
+                this_thread::yield();
+    }
+}
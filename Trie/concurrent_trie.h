@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/// Trie safe to use from many threads at once. search and starts_with take no locks and never wait;
+/// insert publishes new nodes with compare-and-swap and runs concurrently with everything else.
+///
+/// A node with few children keeps them in a small immutable sorted table that is replaced as a whole
+/// (copy-on-write) when a child is added, a node with many children switches to a dense table of 256
+/// atomic slots filled in place. Replaced tables are reclaimed once no reader can still see them:
+/// readers count themselves in per-thread-group counters of the current epoch parity, and a writer
+/// frees retired tables after flipping the epoch twice and seeing both parities drain.
+class concurrent_trie {
+private:
+    struct node;
+
+    struct child_table {
+        uint16_t count;
+        bool dense;
+    };
+
+    struct small_table : child_table {
+        static constexpr uint16_t CAPACITY = 16;
+        uint8_t keys[CAPACITY];
+        node *children[CAPACITY];
+    };
+
+    struct dense_table : child_table {
+        std::atomic<node *> children[256];
+    };
+
+    struct node {
+        std::atomic<bool> is_word{false};
+        std::atomic<child_table *> table{nullptr};
+    };
+
+    // readers are spread over this many counter pairs, each on its own cache line
+    static constexpr size_t READER_SLOTS = 64;
+    // retired tables are reclaimed in batches of this size
+    static constexpr size_t RECLAIM_BATCH = 64;
+
+    struct alignas(64) reader_slot {
+        std::atomic<uint64_t> active[2] = {0, 0}; // readers inside a critical section, per epoch parity
+    };
+
+    /// marks a read-side critical section of the calling thread
+    class read_guard {
+    public:
+        explicit read_guard(const concurrent_trie &owner);
+
+        ~read_guard();
+
+    private:
+        std::atomic<uint64_t> *counter;
+    };
+
+    node *root;
+    mutable reader_slot slots[READER_SLOTS];
+    std::atomic<uint64_t> epoch{0};
+
+    std::mutex reclaim_mutex;
+    std::vector<child_table *> retired;
+
+    [[nodiscard]] static node *find_child(const child_table *table, uint8_t byte);
+
+    /// table with all children of table and the new one, table may be nullptr
+    static child_table *with_child(const child_table *table, uint8_t byte, node *child);
+
+    static void destroy_table(child_table *table);
+
+    /// node reached by the key or nullptr
+    [[nodiscard]] const node *find(const std::string &key) const;
+
+    /// frees the tables once every reader that could still see them has left
+    void retire(std::vector<child_table *> &tables);
+
+    /// waits until no reader is in a critical section that began before the call
+    void synchronize();
+
+public:
+    concurrent_trie();
+
+    concurrent_trie(const concurrent_trie &) = delete;
+
+    concurrent_trie &operator=(const concurrent_trie &) = delete;
+
+    /// must not run concurrently with any other call
+    virtual ~concurrent_trie();
+
+    /** Inserts a word into the trie. */
+    void insert(const std::string &word);
+
+    /** Returns if the word is in the trie. */
+    bool search(const std::string &word) const;
+
+    /** Returns if there is any word in the trie that starts with the given prefix. */
+    bool starts_with(const std::string &prefix) const;
+};
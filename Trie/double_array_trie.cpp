@@ -0,0 +1,213 @@
+#include "double_array_trie.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+    const char MAGIC[8] = {'D', 'A', 'T', 'R', 'I', 'E', '\0', '\0'};
+    const uint32_t VERSION = 1;
+    // reads back as 0x04030201 on a machine of the other byte order
+    const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+    struct file_header {
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order;
+        uint64_t unit_count;
+        uint64_t checksum; // of the units
+    };
+
+    // a free unit is no longer tried as the place of a first child after this many failures
+    const uint8_t MAX_FAILURES = 16, UNLISTED = 0xFF;
+
+    /// 64-bit multiply-xor hash over 8-byte words
+    uint64_t checksum(const double_array_trie::unit *units, size_t count) {
+        uint64_t h = 0x9E3779B97F4A7C15ull;
+        for (size_t i = 0; i < count; ++i) {
+            uint64_t word = (uint64_t)units[i].base << 32 | units[i].check;
+            h = (h ^ word) * 0xFF51AFD7ED558CCDull;
+            h ^= h >> 32;
+        }
+        return h;
+    }
+}
+
+double_array_trie::builder::builder() {
+    // unit 0 is the root, it anchors the free list and is never free
+    units.push_back({0, 0});
+    next_free.push_back(0);
+    prev_free.push_back(0);
+    failures.push_back(UNLISTED);
+}
+
+void double_array_trie::builder::grow(size_t size) {
+    for (size_t i = units.size(); i < size; ++i) {
+        units.push_back({0, 0});
+        // append to the end of the list
+        next_free.push_back(0);
+        prev_free.push_back(prev_free[0]);
+        failures.push_back(0);
+        next_free[prev_free[0]] = (uint32_t)i;
+        prev_free[0] = (uint32_t)i;
+    }
+}
+
+void double_array_trie::builder::unlink(uint32_t index) {
+    next_free[prev_free[index]] = next_free[index];
+    prev_free[next_free[index]] = prev_free[index];
+    failures[index] = UNLISTED;
+}
+
+void double_array_trie::builder::claim(uint32_t index) {
+    if (failures[index] != UNLISTED)
+        unlink(index);
+}
+
+uint32_t double_array_trie::builder::place(uint32_t state, const uint8_t *bytes, size_t count) {
+    uint32_t first = bytes[0] + 1u;
+
+    // try every free unit as the place of the first child, the list only grows at its end
+    uint32_t base = 0;
+    for (uint32_t free = next_free[0], next;; free = next) {
+        next = next_free[free];
+        if (free == 0) {
+            // no free unit fits: put the children right behind the end of the array
+            base = (uint32_t)max<size_t>(units.size(), first) - first;
+            break;
+        }
+        if (free < first)
+            continue;
+
+        base = free - first;
+        bool fits = true;
+        for (size_t i = 1; i < count && fits; ++i) {
+            size_t t = base + bytes[i] + 1;
+            fits = t >= units.size() || units[t].check == 0;
+        }
+        if (fits)
+            break;
+        if (++failures[free] == MAX_FAILURES)
+            unlink(free);
+    }
+
+    grow(base + bytes[count - 1] + 2);
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t t = base + bytes[i] + 1;
+        units[t].check = state + 1;
+        claim(t);
+    }
+    units[state].base = base << 1 | (units[state].base & 1);
+    return base;
+}
+
+void double_array_trie::builder::mark_word(uint32_t state) {
+    units[state].base |= 1;
+}
+
+double_array_trie double_array_trie::builder::finish() {
+    return double_array_trie(move(units));
+}
+
+double_array_trie::double_array_trie(vector<unit> units)
+        : owned(move(units)), units(owned.data()), unit_count(owned.size()) {}
+
+double_array_trie::double_array_trie(void *mapping, size_t mapping_size, const unit *units, size_t unit_count)
+        : units(units), unit_count(unit_count), mapping(mapping), mapping_size(mapping_size) {}
+
+double_array_trie::double_array_trie(double_array_trie &&other) noexcept
+        : owned(move(other.owned)), units(other.units), unit_count(other.unit_count),
+          mapping(other.mapping), mapping_size(other.mapping_size) {
+    other.units = nullptr;
+    other.unit_count = 0;
+    other.mapping = nullptr;
+    other.mapping_size = 0;
+}
+
+double_array_trie &double_array_trie::operator=(double_array_trie &&other) noexcept {
+    swap(owned, other.owned);
+    swap(units, other.units);
+    swap(unit_count, other.unit_count);
+    swap(mapping, other.mapping);
+    swap(mapping_size, other.mapping_size);
+    return *this;
+}
+
+double_array_trie::~double_array_trie() {
+    if (mapping)
+        munmap(mapping, mapping_size);
+}
+
+long double_array_trie::walk(const string &key) const {
+    if (unit_count == 0)
+        return -1;
+
+    size_t state = 0;
+    for (const char& c: key) {
+        size_t next = (units[state].base >> 1) + (uint8_t)c + 1;
+        if (next >= unit_count || units[next].check != state + 1)
+            return -1;
+        state = next;
+    }
+
+    return (long)state;
+}
+
+bool double_array_trie::search(const string &word) const {
+    long state = walk(word);
+    return state != -1 && (units[state].base & 1);
+}
+
+bool double_array_trie::starts_with(const string &prefix) const {
+    return walk(prefix) != -1;
+}
+
+bool double_array_trie::save(const string &path) const {
+    file_header header{};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.byte_order = BYTE_ORDER_MARK;
+    header.unit_count = unit_count;
+    header.checksum = checksum(units, unit_count);
+
+    ofstream out(path, ios::binary | ios::trunc);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(units), (streamsize)(unit_count * sizeof(unit)));
+    return (bool)out.flush();
+}
+
+optional<double_array_trie> double_array_trie::load(const string &path, bool verify_checksum) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+        return nullopt;
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(file_header)) {
+        close(fd);
+        return nullopt;
+    }
+    void *mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    // the mapping keeps the file alive on its own
+    close(fd);
+    if (mapping == MAP_FAILED)
+        return nullopt;
+
+    file_header header{};
+    memcpy(&header, mapping, sizeof(header));
+    auto units = reinterpret_cast<const unit *>(static_cast<const char *>(mapping) + sizeof(header));
+    double_array_trie result(mapping, st.st_size, units, header.unit_count);
+
+    if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION
+        || header.byte_order != BYTE_ORDER_MARK
+        || (size_t)st.st_size != sizeof(header) + header.unit_count * sizeof(unit))
+        return nullopt;
+    if (verify_checksum && checksum(units, header.unit_count) != header.checksum)
+        return nullopt;
+    return result;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+/// Read-only trie packed into one double array, built by trie::freeze.
+/// State s moves by byte c to t = base(s) + c + 1 if check(t) == s + 1, so a lookup is two array
+/// reads per byte. Path-compressed edges are expanded into one state per byte. The array has no
+/// pointers inside, so it is written to a file as is and mapped back without any parsing.
+class double_array_trie {
+public:
+    struct unit {
+        uint32_t base; // lowest bit - a word ends in this state, the rest - base of the children
+        uint32_t check; // parent state plus one, 0 - the unit is free
+    };
+
+    /// Lays out states one at a time: every placed state gets a base at which all of its
+    /// children fall into free units. Free units are kept in a doubly linked list, so finding
+    /// a base only looks at free units; a unit that keeps failing is dropped from the list
+    /// (it stays free and can still take a child that isn't the first one).
+    class builder {
+    public:
+        builder();
+
+        /// claims units for the children of a placed state, the root is state 0
+        /// \param bytes bytes of the children in ascending order, at least one
+        /// \return base of the state, child of byte c is the state base + c + 1
+        uint32_t place(uint32_t state, const uint8_t *bytes, size_t count);
+
+        void mark_word(uint32_t state);
+
+        double_array_trie finish();
+
+    private:
+        std::vector<unit> units;
+        std::vector<uint32_t> next_free, prev_free; // circular list of free units, anchored at unit 0
+        // failed attempts to place a first child in a listed free unit, UNLISTED once it is out of the list
+        std::vector<uint8_t> failures;
+
+        void grow(size_t size);
+
+        void unlink(uint32_t index);
+
+        void claim(uint32_t index);
+    };
+
+    double_array_trie(const double_array_trie &) = delete;
+
+    double_array_trie &operator=(const double_array_trie &) = delete;
+
+    double_array_trie(double_array_trie &&other) noexcept;
+
+    double_array_trie &operator=(double_array_trie &&other) noexcept;
+
+    virtual ~double_array_trie();
+
+    /** Returns if the word is in the trie. */
+    [[nodiscard]] bool search(const std::string &word) const;
+
+    /** Returns if there is any word in the trie that starts with the given prefix. */
+    [[nodiscard]] bool starts_with(const std::string &prefix) const;
+
+    /// number of units, free ones included
+    [[nodiscard]] size_t size() const {
+        return unit_count;
+    }
+
+    /// writes the array with a versioned, checksummed header
+    /// \return false if the file couldn't be written
+    bool save(const std::string &path) const;
+
+    /// maps a file written by save, the pages are shared by every process mapping it
+    /// \param verify_checksum whether to hash the whole file, which reads every page of it; off by default
+    /// so that loading only touches the header, meant for an offline check of a file
+    /// \return nothing if the file can't be mapped or is damaged
+    static std::optional<double_array_trie> load(const std::string &path, bool verify_checksum = false);
+
+private:
+    std::vector<unit> owned; // the units of a frozen trie, empty for a mapped one
+    const unit *units = nullptr;
+    size_t unit_count = 0;
+    void *mapping = nullptr;
+    size_t mapping_size = 0;
+
+    explicit double_array_trie(std::vector<unit> units);
+
+    double_array_trie(void *mapping, size_t mapping_size, const unit *units, size_t unit_count);
+
+    /// state reached by the key or -1
+    [[nodiscard]] long walk(const std::string &key) const;
+};
@@ -1,47 +1,613 @@
 #include "trie.h"
 
+#include <algorithm>
+#include <future>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+
 using namespace std;
 
-trie::trie() {
-    root = new trie_node();
+trie::trie(bool path_compressed) : path_compressed(path_compressed) {
+    root = arena.allocate(trie_node::kind::node4);
 }
 
-trie::~trie() {
-    delete root;
+trie::~trie() = default;
+
+void trie::insert(const string &word, uint32_t weight) {
+    insert_from(&root, 0, word, weight, nullptr);
 }
 
-void trie::insert(const string &word) {
-    trie_node* iter = root;
+void trie::insert_sorted(const vector<string> &words, const vector<uint32_t> &weights, unsigned threads) {
+    if (!weights.empty() && weights.size() != words.size())
+        throw invalid_argument("trie::insert_sorted: a weight is needed for every word");
+    if (!is_sorted(words.begin(), words.end()))
+        throw invalid_argument("trie::insert_sorted: words are not sorted");
+    if (threads == 0)
+        threads = max(1u, thread::hardware_concurrency());
+    const uint32_t *weight = weights.empty() ? nullptr : weights.data();
+
+    // the empty words come first and mark the root
+    size_t begin = partition_point(words.begin(), words.end(), [](const string &word) {
+        return word.empty();
+    }) - words.begin();
+    insert_run(words.data(), weight, begin);
+
+    // ranges of about equal size, a range ends where the first byte changes
+    vector<size_t> bounds = {begin};
+    for (unsigned part = 1; part < threads; ++part) {
+        size_t bound = begin + (words.size() - begin) * part / threads;
+        if (bound <= bounds.back())
+            continue;
+        char first = words[bound - 1][0];
+        bound = partition_point(words.begin() + bound, words.end(), [&](const string &word) {
+            return word[0] == first;
+        }) - words.begin();
+        if (bound == words.size())
+            break;
+        bounds.push_back(bound);
+    }
+    bounds.push_back(words.size());
+
+    if (bounds.size() == 2 || arena.get(root)->count) {
+        insert_run(words.data() + begin, weight ? weight + begin : nullptr, words.size() - begin);
+        return;
+    }
 
-    for (const char& c: word) {
-        if (iter->children.count(c) == 0)
-            iter->children[c] = new trie_node();
-        iter = iter->children[c];
+    vector<unique_ptr<trie>> parts;
+    vector<future<void>> builds;
+    for (size_t i = 0; i + 1 < bounds.size(); ++i) {
+        parts.emplace_back(new trie(path_compressed));
+        trie *part = parts.back().get();
+        size_t first = bounds[i], count = bounds[i + 1] - bounds[i];
+        builds.push_back(async(launch::async, [=, &words] {
+            part->insert_run(words.data() + first, weight ? weight + first : nullptr, count);
+        }));
     }
+    for (auto &build: builds)
+        build.get();
 
-    iter->is_word = true;
+    // the subtrees of the first bytes are moved under the root, their roots are dropped
+    for (auto &part: parts) {
+        node_ref part_root = arena.absorb(part->arena, part->root);
+        trie_node *node = arena.get(part_root);
+        node->for_each_child([&](uint8_t byte, node_ref child) {
+            trie_node::add_child(arena, root, byte, child);
+        });
+        trie_node *top = arena.get(root);
+        top->max_weight = max(top->max_weight, node->max_weight);
+        arena.release(part_root);
+    }
 }
 
-bool trie::search(const string &word) {
-    trie_node* iter = root;
+void trie::insert_run(const string *words, const uint32_t *weights, size_t count) {
+    vector<cursor> path;
+    auto leave = [&] {
+        uint32_t max_weight = arena.get(*path.back().slot)->max_weight;
+        path.pop_back();
+        trie_node *parent = arena.get(*path.back().slot);
+        parent->max_weight = max(parent->max_weight, max_weight);
+    };
+
+    for (size_t i = 0; i < count; ++i) {
+        const string &word = words[i];
+        uint32_t weight = weights ? weights[i] : 0;
+        if (path.empty()) {
+            insert_from(&root, 0, word, weight, &path);
+            continue;
+        }
 
-    for (const char& c: word) {
-        if (iter->children.count(c) == 0)
-            return false;
-        iter = iter->children[c];
+        // nodes whose key byte lies behind the common prefix are done
+        const string &previous = words[i - 1];
+        size_t common = mismatch(previous.begin(), previous.begin() + min(previous.size(), word.size()),
+                                 word.begin()).first - previous.begin();
+        while (path.back().pos > common)
+            leave();
+
+        cursor resume = path.back();
+        path.pop_back();
+        insert_from(resume.slot, resume.pos, word, weight, &path);
     }
 
-    return iter->is_word;
+    while (path.size() > 1)
+        leave();
 }
 
-bool trie::starts_with(const string &prefix) {
-    trie_node* iter = root;
+void trie::insert_from(node_ref *iter, size_t pos, const string &word, uint32_t weight, vector<cursor> *path) {
+    // a node may be replaced by a larger one or split while the word is added,
+    // so the walk holds the slot referring to the current node
+    while (true) {
+        if (!shared.empty())
+            unshare(*iter);
+        if (path)
+            path->push_back({iter, pos});
+        trie_node *node = arena.get(*iter);
+        const char *label = arena.label(node);
+        size_t matched = mismatch(label, label + min<size_t>(node->label_length, word.size() - pos),
+                                  word.begin() + pos).first - label;
+
+        if (matched < node->label_length) {
+            // the word leaves the edge in the middle: a new node takes the matched part of the label
+            // and the old node keeps the rest of it behind the first differing byte
+            node_ref middle = arena.allocate(trie_node::kind::node4);
+            trie_node *split = arena.get(middle);
+            split->label_offset = node->label_offset;
+            split->label_length = (uint32_t)matched;
+            split->max_weight = node->max_weight;
+            auto byte = (uint8_t)label[matched];
+            node->label_offset += matched + 1;
+            node->label_length -= matched + 1;
+
+            node_ref old = *iter;
+            *iter = middle;
+            trie_node::add_child(arena, *iter, byte, old);
+            node = split;
+        }
+        pos += matched;
+        node->max_weight = max(node->max_weight, weight);
+
+        if (pos == word.size()) {
+            bool lowered = node->is_word && weight < node->weight;
+            node->is_word = true;
+            node->weight = weight;
+            if (lowered)
+                update_max_weights(word);
+            return;
+        }
+
+        auto byte = (uint8_t)word[pos++];
+        node_ref *next = node->find_child_slot(byte);
+        if (next) {
+            iter = next;
+            continue;
+        }
+
+        // the rest of the word becomes one labeled leaf, or a chain of one node per byte
+        node_ref leaf = arena.allocate(trie_node::kind::node4);
+        next = trie_node::add_child(arena, *iter, byte, leaf);
+        if (path_compressed) {
+            trie_node *added = arena.get(leaf);
+            added->label_offset = arena.add_label(word.data() + pos, word.size() - pos);
+            added->label_length = (uint32_t)(word.size() - pos);
+            added->is_word = true;
+            added->weight = added->max_weight = weight;
+            if (path)
+                path->push_back({next, pos});
+            return;
+        }
+        iter = next;
+    }
+}
+
+bool trie::erase(const string &word) {
+    position found = find(word);
+    if (!found.node || found.matched != found.node->label_length || !found.node->is_word)
+        return false;
+
+    // slots of the nodes on the path and the key bytes between them, shared nodes are copied first
+    vector<node_ref *> path = {&root};
+    vector<uint8_t> keys;
+    for (size_t pos = 0;;) {
+        if (!shared.empty())
+            unshare(*path.back());
+        pos += arena.get(*path.back())->label_length;
+        if (pos == word.size())
+            break;
+        keys.push_back((uint8_t)word[pos++]);
+        path.push_back(arena.get(*path.back())->find_child_slot(keys.back()));
+    }
+
+    trie_node *node = arena.get(*path.back());
+    node->is_word = false;
+    node->weight = 0;
+
+    // the parent may shrink into a new node, but only the slots below it, which are gone, move with it
+    size_t depth = path.size() - 1;
+    for (; depth > 0; --depth) {
+        node = arena.get(*path[depth]);
+        if (node->is_word || node->count)
+            break;
+        arena.release(*path[depth]);
+        trie_node::remove_child(arena, *path[depth - 1], keys[depth - 1]);
+    }
+    // what the parent has counted in its max_weight, the node may be merged away below
+    uint32_t counted = arena.get(*path[depth])->max_weight;
+    if (path_compressed && depth > 0) {
+        node = arena.get(*path[depth]);
+        if (!node->is_word && node->count == 1)
+            merge_with_child(*path[depth]);
+    }
 
-    for (const char& c: prefix) {
-        if (iter->children.count(c) == 0)
-            return false;
-        iter = iter->children[c];
+    // up to the first node whose max_weight stays the same
+    for (size_t d = depth + 1; d-- > 0;) {
+        node = arena.get(*path[d]);
+        uint32_t max_weight = node->is_word ? node->weight : 0;
+        node->for_each_child([&](uint8_t, node_ref child) {
+            max_weight = max(max_weight, arena.get(child)->max_weight);
+        });
+        uint32_t previous = d == depth ? counted : node->max_weight;
+        node->max_weight = max_weight;
+        if (max_weight == previous)
+            break;
     }
 
+    if (arena.label_size() > 2 * max(compacted_labels, arena.size()))
+        compacted_labels = arena.compact_labels(root);
     return true;
-}
\ No newline at end of file
+}
+
+bool trie::search(const string &word) {
+    position found = find(word);
+    return found.node && found.matched == found.node->label_length && found.node->is_word;
+}
+
+bool trie::starts_with(const string &prefix) {
+    return find(prefix).node != nullptr;
+}
+
+size_t trie::complete(const string &prefix, size_t k, completion *out) const {
+    position start = find(prefix);
+    if (!start.node || k == 0)
+        return 0;
+
+    // every reached node is remembered with the way back to the start, words are spelled out only when found
+    struct reached {
+        const trie_node *node;
+        int parent;
+        uint8_t byte;
+    };
+    vector<reached> nodes = {{start.node, -1, 0}};
+
+    // (weight bound, is not a word, discovery order, node): words come before subtrees of the same weight
+    using entry = tuple<uint32_t, bool, int, int>;
+    auto worse = [](const entry &a, const entry &b) {
+        if (get<0>(a) != get<0>(b))
+            return get<0>(a) < get<0>(b);
+        if (get<1>(a) != get<1>(b))
+            return get<1>(a);
+        return get<2>(a) > get<2>(b);
+    };
+    priority_queue<entry, vector<entry>, decltype(worse)> frontier(worse);
+    int discovered = 0;
+    frontier.emplace(start.node->max_weight, true, discovered++, 0);
+
+    size_t found = 0;
+    while (found < k && !frontier.empty()) {
+        auto [bound, is_subtree, order, index] = frontier.top();
+        frontier.pop();
+
+        if (!is_subtree) {
+            // the prefix, the rest of the start label, then the key byte and the label of every node below
+            string &word = out[found++].word;
+            word.assign(prefix);
+            word.append(arena.label(start.node) + start.matched, start.node->label_length - start.matched);
+            size_t tail = word.size();
+            for (int i = index; nodes[i].parent != -1; i = nodes[i].parent) {
+                const trie_node *node = nodes[i].node;
+                word.append(arena.label(node), node->label_length);
+                reverse(word.end() - node->label_length, word.end());
+                word.push_back((char)nodes[i].byte);
+            }
+            reverse(word.begin() + tail, word.end());
+            out[found - 1].weight = bound;
+            continue;
+        }
+
+        const trie_node *node = nodes[index].node;
+        if (node->is_word)
+            frontier.emplace(node->weight, false, discovered++, index);
+        node->for_each_child([&](uint8_t byte, node_ref child) {
+            nodes.push_back({arena.get(child), index, byte});
+            frontier.emplace(nodes.back().node->max_weight, true, discovered++, (int)nodes.size() - 1);
+        });
+    }
+
+    return found;
+}
+
+vector<fuzzy_match> trie::fuzzy_search(const string &word, uint32_t max_distance) const {
+    vector<fuzzy_match> result;
+    size_t width = word.size() + 1;
+
+    // rows[d * width + j] - distance between the first d spelled bytes and the first j bytes of the word;
+    // a node is entered with the row of the bytes above its key byte, which no sibling overwrites
+    vector<uint32_t> rows(width);
+    for (size_t j = 0; j < width; ++j)
+        rows[j] = (uint32_t)j;
+    string spelled;
+
+    struct pending {
+        const trie_node *node;
+        uint8_t byte; // key byte leading to the node
+        size_t depth; // bytes spelled above the key byte
+    };
+    vector<pending> stack;
+    // children are pushed last to first, so they are visited in the order of their bytes
+    auto push_children = [&](const trie_node *node) {
+        size_t top = stack.size() + node->count;
+        stack.resize(top);
+        node->for_each_child([&](uint8_t byte, node_ref child) {
+            stack[--top] = {arena.get(child), byte, spelled.size()};
+        });
+    };
+
+    // the root has no label
+    const trie_node *top = arena.get(root);
+    if (top->is_word && word.size() <= max_distance)
+        result.push_back({"", (uint32_t)word.size()});
+    push_children(top);
+
+    while (!stack.empty()) {
+        auto [node, byte, depth] = stack.back();
+        stack.pop_back();
+
+        spelled.resize(depth);
+        spelled.push_back((char)byte);
+        spelled.append(arena.label(node), node->label_length);
+        rows.resize((spelled.size() + 1) * width);
+
+        bool reachable = true;
+        for (size_t d = depth; d < spelled.size() && reachable; ++d) {
+            const uint32_t *above = rows.data() + d * width;
+            uint32_t *row = rows.data() + (d + 1) * width;
+            row[0] = above[0] + 1;
+            uint32_t best = row[0];
+            for (size_t j = 1; j < width; ++j) {
+                row[j] = min({above[j] + 1, row[j - 1] + 1, above[j - 1] + (word[j - 1] != spelled[d])});
+                best = min(best, row[j]);
+            }
+            reachable = best <= max_distance;
+        }
+        if (!reachable)
+            continue;
+
+        uint32_t distance = rows[spelled.size() * width + word.size()];
+        if (node->is_word && distance <= max_distance)
+            result.push_back({spelled, distance});
+        push_children(node);
+    }
+
+    return result;
+}
+
+double_array_trie trie::freeze() const {
+    double_array_trie::builder builder;
+
+    // states are laid out breadth-first, a labeled edge turns into one state per byte
+    struct pending {
+        const trie_node *node;
+        uint32_t label_pos; // bytes of the node's label already turned into states
+        uint32_t state;
+    };
+    queue<pending> order;
+    order.push({arena.get(root), 0, 0});
+
+    vector<uint8_t> bytes;
+    vector<const trie_node *> children;
+    while (!order.empty()) {
+        auto [node, label_pos, state] = order.front();
+        order.pop();
+
+        if (label_pos < node->label_length) {
+            auto byte = (uint8_t)arena.label(node)[label_pos];
+            uint32_t base = builder.place(state, &byte, 1);
+            order.push({node, label_pos + 1, base + byte + 1});
+            continue;
+        }
+
+        if (node->is_word)
+            builder.mark_word(state);
+        bytes.clear();
+        children.clear();
+        node->for_each_child([&](uint8_t byte, node_ref child) {
+            bytes.push_back(byte);
+            children.push_back(arena.get(child));
+        });
+        if (bytes.empty())
+            continue;
+
+        uint32_t base = builder.place(state, bytes.data(), bytes.size());
+        for (size_t i = 0; i < bytes.size(); ++i)
+            order.push({children[i], 0, base + bytes[i] + 1});
+    }
+
+    return builder.finish();
+}
+
+aho_corasick trie::automaton() const {
+    aho_corasick::builder builder;
+
+    // depth-first with the children in the order of their bytes reaches the words in sorted order,
+    // a labeled edge turns into one state per byte
+    struct pending {
+        const trie_node *node;
+        uint32_t label_pos; // bytes of the node's label already turned into states
+        uint32_t state;
+    };
+    vector<pending> stack = {{arena.get(root), 0, 0}};
+
+    while (!stack.empty()) {
+        auto [node, label_pos, state] = stack.back();
+        stack.pop_back();
+
+        if (label_pos < node->label_length) {
+            auto byte = (uint8_t)arena.label(node)[label_pos];
+            stack.push_back({node, label_pos + 1, builder.add_state(state, byte)});
+            continue;
+        }
+
+        if (node->is_word && state != 0)
+            builder.mark_pattern(state);
+        // children are pushed last to first, but their states are made first to last
+        size_t top = stack.size() + node->count;
+        stack.resize(top);
+        node->for_each_child([&](uint8_t byte, node_ref child) {
+            stack[--top] = {arena.get(child), 0, builder.add_state(state, byte)};
+        });
+    }
+
+    return builder.finish();
+}
+
+void trie::minimize() {
+    trie_arena minimal;
+    unordered_map<node_ref, node_ref> moved; // node of this arena to its node in the new one
+    unordered_map<uint64_t, vector<node_ref>> kept; // nodes of the new arena by the hash of their content
+
+    // everything but the layout is compared, children by their references in the new arena
+    using edges = vector<pair<uint8_t, node_ref>>;
+    auto edges_of = [](const trie_node *node, const unordered_map<node_ref, node_ref> *rename) {
+        edges result;
+        node->for_each_child([&](uint8_t byte, node_ref child) {
+            result.emplace_back(byte, rename ? rename->at(child) : child);
+        });
+        return result;
+    };
+    auto mix = [](uint64_t h, uint64_t value) {
+        h = (h ^ value) * 0xFF51AFD7ED558CCDull;
+        return h ^ h >> 32;
+    };
+
+    // post-order, a node is merged after all of its children
+    vector<pair<node_ref, bool>> stack = {{root, false}};
+    while (!stack.empty()) {
+        auto [ref, expanded] = stack.back();
+        if (moved.count(ref)) {
+            stack.pop_back();
+            continue;
+        }
+        const trie_node *node = arena.get(ref);
+        if (!expanded) {
+            stack.back().second = true;
+            node->for_each_child([&](uint8_t, node_ref child) {
+                stack.emplace_back(child, false);
+            });
+            continue;
+        }
+        stack.pop_back();
+
+        edges children = edges_of(node, &moved);
+        const char *label = arena.label(node);
+        uint64_t h = mix(mix(0x9E3779B97F4A7C15ull, node->is_word), (uint64_t)node->weight << 32 | node->max_weight);
+        for (uint32_t i = 0; i < node->label_length; ++i)
+            h = mix(h, (uint8_t)label[i]);
+        for (auto [byte, child]: children)
+            h = mix(h, (uint64_t)byte << 32 | child);
+
+        vector<node_ref> &same_hash = kept[h];
+        auto equal_node = find_if(same_hash.begin(), same_hash.end(), [&](node_ref candidate) {
+            const trie_node *other = minimal.get(candidate);
+            return other->is_word == node->is_word && other->weight == node->weight
+                   && other->max_weight == node->max_weight && other->label_length == node->label_length
+                   && equal(label, label + node->label_length, minimal.label(other))
+                   && edges_of(other, nullptr) == children;
+        });
+        if (equal_node != same_hash.end()) {
+            moved[ref] = *equal_node;
+            continue;
+        }
+
+        node_ref copy = minimal.copy(node);
+        trie_node *added = minimal.get(copy);
+        added->label_offset = minimal.add_label(label, node->label_length);
+        for (auto [byte, child]: children)
+            *added->find_child_slot(byte) = child;
+        same_hash.push_back(copy);
+        moved[ref] = copy;
+    }
+
+    root = moved.at(root);
+    arena = move(minimal);
+
+    unordered_map<node_ref, uint32_t> parents;
+    for (auto &[h, nodes]: kept)
+        for (node_ref ref: nodes)
+            arena.get(ref)->for_each_child([&](uint8_t, node_ref child) {
+                parents[child]++;
+            });
+    shared.clear();
+    for (auto [ref, count]: parents)
+        if (count > 1)
+            shared.emplace(ref, count);
+}
+
+size_t trie::node_count() const {
+    return arena.size();
+}
+
+size_t trie::memory_usage() const {
+    return arena.memory_usage();
+}
+
+trie::position trie::find(const string &key) const {
+    const trie_node* iter = arena.get(root);
+    size_t pos = 0;
+
+    while (true) {
+        // the label is compared in one go, the key may end inside it
+        size_t length = min<size_t>(iter->label_length, key.size() - pos);
+        if (!equal(key.begin() + pos, key.begin() + pos + length, arena.label(iter)))
+            return {nullptr, 0};
+        if (pos + iter->label_length >= key.size())
+            return {iter, (uint32_t)length};
+        pos += iter->label_length;
+
+        node_ref next = iter->find_child((uint8_t)key[pos++]);
+        if (next == trie_arena::NO_NODE)
+            return {nullptr, 0};
+        iter = arena.get(next);
+    }
+}
+
+void trie::unshare(node_ref &slot) {
+    auto found = shared.find(slot);
+    if (found == shared.end())
+        return;
+    if (--found->second == 1)
+        shared.erase(found);
+
+    slot = arena.copy(arena.get(slot));
+    arena.get(slot)->for_each_child([&](uint8_t, node_ref child) {
+        auto [parents, added] = shared.emplace(child, 2);
+        if (!added)
+            parents->second++;
+    });
+}
+
+void trie::merge_with_child(node_ref &slot) {
+    trie_node *node = arena.get(slot);
+    uint8_t byte = 0;
+    node->for_each_child([&](uint8_t key, node_ref) {
+        byte = key;
+    });
+    node_ref *child_slot = node->find_child_slot(byte);
+    if (!shared.empty())
+        unshare(*child_slot);
+    node_ref child_ref = *child_slot;
+    trie_node *child = arena.get(child_ref);
+
+    string label(arena.label(node), node->label_length);
+    label.push_back((char)byte);
+    label.append(arena.label(child), child->label_length);
+    child->label_offset = arena.add_label(label.data(), label.size());
+    child->label_length = (uint32_t)label.size();
+
+    arena.release(slot);
+    slot = child_ref;
+}
+
+void trie::update_max_weights(const string &word) {
+    vector<trie_node *> path = {arena.get(root)};
+    for (size_t pos = path.back()->label_length; pos < word.size(); pos += path.back()->label_length)
+        path.push_back(arena.get(path.back()->find_child((uint8_t)word[pos++])));
+
+    for (auto it = path.rbegin(); it != path.rend(); ++it) {
+        trie_node *node = *it;
+        node->max_weight = node->is_word ? node->weight : 0;
+        node->for_each_child([&](uint8_t, node_ref child) {
+            node->max_weight = max(node->max_weight, arena.get(child)->max_weight);
+        });
+    }
+}
@@ -1,22 +1,133 @@
+#pragma once
+
+#include <cstdint>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "trie_node.h"
+#include "trie_arena.h"
+#include "double_array_trie.h"
+#include "aho_corasick.h"
+
+/// word found by trie::complete
+struct completion {
+    std::string word;
+    uint32_t weight;
+};
+
+/// word found by trie::fuzzy_search
+struct fuzzy_match {
+    std::string word;
+    uint32_t distance;
+};
 
 class trie {
 private:
-    trie_node *root;
+    trie_arena arena;
+    node_ref root;
+    bool path_compressed;
+    size_t compacted_labels = 0; // bytes left in the label pool by its last compaction
+    // number of parents of every node with more than one, all nodes are single-parented until minimize
+    std::unordered_map<node_ref, uint32_t> shared;
+
+    /// where a key ends in the trie
+    struct position {
+        const trie_node *node; // node whose edge the key ends on, nullptr if no word starts with the key
+        uint32_t matched; // bytes of the node's label covered by the key
+    };
+
+    [[nodiscard]] position find(const std::string &key) const;
+
+    /// slot of a node on the path of a word and the position in the word where the node's label starts
+    struct cursor {
+        node_ref *slot;
+        size_t pos;
+    };
+
+    /// inserts the word from a node on its path down
+    /// \param iter slot of the node, the node's label starts at pos
+    /// \param path receives the nodes passed from iter on, nullptr if they aren't needed
+    void insert_from(node_ref *iter, size_t pos, const std::string &word, uint32_t weight, std::vector<cursor> *path);
+
+    /// inserts sorted words, each one from the deepest node it shares with the previous one;
+    /// the max_weight of a node above the resumed one is brought up to date when the node is left
+    void insert_run(const std::string *words, const uint32_t *weights, size_t count);
+
+    /// replaces a node with more than one parent by a copy of its own, which is the only parent of
+    /// the node's children that is changed, so nothing reachable through the other parents changes
+    void unshare(node_ref &slot);
+
+    /// joins a node that is no word and has one child with the child, which takes its place
+    /// and the concatenated label
+    void merge_with_child(node_ref &slot);
+
+    /// recomputes max_weight of every node on the path of the word, bottom-up
+    void update_max_weights(const std::string &word);
 public:
-    /** Initialize your data structure here. */
-    trie();
+    /** Initialize your data structure here.
+     *  A path-compressed trie collapses chains of single-child nodes into labeled edges. */
+    explicit trie(bool path_compressed = false);
+
+    trie(const trie &) = delete;
+
+    trie &operator=(const trie &) = delete;
 
     virtual ~trie();
 
-    /** Inserts a word into the trie. */
-    void insert(const std::string &word);
+    /** Inserts a word into the trie, the weight replaces the one of an already present word. */
+    void insert(const std::string &word, uint32_t weight = 0);
+
+    /// Inserts words given in sorted order, duplicates allowed, the last weight wins. A word continues
+    /// from the deepest node it shares with the previous word instead of the root, so a shared prefix
+    /// is walked once. Into an empty trie, disjoint first-byte ranges of about equal size are built on
+    /// separate threads, each into its own arena, and the arenas are then moved into this one.
+    /// \param weights weight of every word, empty for all 0
+    /// \param threads threads to build with, 0 for one per hardware thread
+    void insert_sorted(const std::vector<std::string> &words, const std::vector<uint32_t> &weights = {},
+                       unsigned threads = 0);
+
+    /// Removes a word. Nodes left with neither a word nor children are released to the free lists of
+    /// the arena, a node that got sparse enough moves into a smaller layout, and in a path-compressed
+    /// trie a node left with one child and no word is joined with the child. The label pool is
+    /// compacted once it has grown to twice its live size, so memory stays flat under churn.
+    /// \return false if the word wasn't in the trie
+    bool erase(const std::string &word);
 
     /** Returns if the word is in the trie. */
     bool search(const std::string &word);
 
     /** Returns if there is any word in the trie that starts with the given prefix. */
     bool starts_with(const std::string &prefix);
-};
\ No newline at end of file
+
+    /// k heaviest words starting with the prefix, heaviest first, ties in the order they are reached.
+    /// Subtrees are expanded best-first by their cached max_weight, so only the nodes that can still
+    /// hold one of the k best words are visited.
+    /// \param out buffer of at least k entries, the strings already in it are reused
+    /// \return number of words written
+    size_t complete(const std::string &prefix, size_t k, completion *out) const;
+
+    /// words within the Levenshtein distance of the word, in sorted order. The trie is walked depth-first
+    /// with one row of the distance matrix per spelled byte, a row is derived from the row of the parent,
+    /// and a subtree is skipped once every entry of its row exceeds the bound.
+    [[nodiscard]] std::vector<fuzzy_match> fuzzy_search(const std::string &word, uint32_t max_distance) const;
+
+    /// packs the words into a read-only double-array trie
+    [[nodiscard]] double_array_trie freeze() const;
+
+    /// matcher for the words as patterns, a word's id is its position in the sorted order of the words;
+    /// the empty word is left out
+    [[nodiscard]] aho_corasick automaton() const;
+
+    /// Merges identical subtrees into one shared subtree, as in a DAWG: nodes with the same word flag,
+    /// weights, label and children are kept once, bottom-up, so common suffixes are stored once.
+    /// The nodes are moved into a new arena, which drops the memory of the merged ones.
+    /// Later changes copy a shared node before changing it, so they never affect other words.
+    void minimize();
+
+    /// number of nodes, the root included
+    [[nodiscard]] size_t node_count() const;
+
+    /// bytes held by the nodes
+    [[nodiscard]] size_t memory_usage() const;
+};
@@ -0,0 +1,176 @@
+#include "trie_arena.h"
+
+#include <cstdint>
+#include <stdexcept>
+#include <unordered_set>
+#include <vector>
+
+using namespace std;
+
+trie_arena::trie_arena() {
+    nodes4.allocate();
+}
+
+node_ref trie_arena::allocate(trie_node::kind kind) {
+    uint32_t index = 0;
+    switch (kind) {
+        case trie_node::kind::node4:
+            index = nodes4.allocate();
+            break;
+        case trie_node::kind::node16:
+            index = nodes16.allocate();
+            break;
+        case trie_node::kind::node48:
+            index = nodes48.allocate();
+            break;
+        case trie_node::kind::node256:
+            index = nodes256.allocate();
+            break;
+    }
+
+    if (index > MAX_INDEX)
+        throw length_error("trie_arena: node index doesn't fit into a node_ref");
+    return (uint32_t)kind << KIND_SHIFT | index;
+}
+
+node_ref trie_arena::copy(const trie_node *node) {
+    node_ref ref = allocate(node->type);
+    trie_node *to = get(ref);
+    switch (node->type) {
+        case trie_node::kind::node4:
+            *static_cast<trie_node4 *>(to) = *static_cast<const trie_node4 *>(node);
+            break;
+        case trie_node::kind::node16:
+            *static_cast<trie_node16 *>(to) = *static_cast<const trie_node16 *>(node);
+            break;
+        case trie_node::kind::node48:
+            *static_cast<trie_node48 *>(to) = *static_cast<const trie_node48 *>(node);
+            break;
+        case trie_node::kind::node256:
+            *static_cast<trie_node256 *>(to) = *static_cast<const trie_node256 *>(node);
+            break;
+    }
+    return ref;
+}
+
+void trie_arena::release(node_ref ref) {
+    uint32_t index = ref & MAX_INDEX;
+    switch (kind_of(ref)) {
+        case trie_node::kind::node4:
+            nodes4.release(index);
+            break;
+        case trie_node::kind::node16:
+            nodes16.release(index);
+            break;
+        case trie_node::kind::node48:
+            nodes48.release(index);
+            break;
+        case trie_node::kind::node256:
+            nodes256.release(index);
+            break;
+    }
+}
+
+trie_node *trie_arena::get(node_ref ref) const {
+    uint32_t index = ref & MAX_INDEX;
+    switch (kind_of(ref)) {
+        case trie_node::kind::node4:
+            return nodes4.at(index);
+        case trie_node::kind::node16:
+            return nodes16.at(index);
+        case trie_node::kind::node48:
+            return nodes48.at(index);
+        case trie_node::kind::node256:
+            return nodes256.at(index);
+    }
+    return nullptr;
+}
+
+node_ref trie_arena::absorb(trie_arena &other, node_ref root) {
+    if (nodes4.capacity() + other.nodes4.capacity() > MAX_INDEX || nodes16.capacity() + other.nodes16.capacity() > MAX_INDEX
+        || nodes48.capacity() + other.nodes48.capacity() > MAX_INDEX
+        || nodes256.capacity() + other.nodes256.capacity() > MAX_INDEX)
+        throw length_error("trie_arena: node index doesn't fit into a node_ref");
+    if (labels.size() + other.labels.size() > UINT32_MAX)
+        throw length_error("trie_arena: label pool doesn't fit into 32-bit offsets");
+
+    uint32_t offsets[4] = {nodes4.absorb(other.nodes4), nodes16.absorb(other.nodes16), nodes48.absorb(other.nodes48),
+                           nodes256.absorb(other.nodes256)};
+    auto label_offset = (uint32_t)labels.size();
+    labels.insert(labels.end(), other.labels.begin(), other.labels.end());
+    other.clear();
+    // the NO_NODE of the other arena
+    nodes4.release(offsets[0]);
+
+    auto rebase = [&](node_ref ref) {
+        return ref + offsets[(int)kind_of(ref)];
+    };
+
+    vector<node_ref> pending = {rebase(root)};
+    while (!pending.empty()) {
+        trie_node *node = get(pending.back());
+        pending.pop_back();
+        if (node->label_length)
+            node->label_offset += label_offset;
+        node->for_each_child([&](uint8_t byte, node_ref child) {
+            *node->find_child_slot(byte) = rebase(child);
+            pending.push_back(rebase(child));
+        });
+    }
+
+    return rebase(root);
+}
+
+uint32_t trie_arena::add_label(const char *bytes, size_t length) {
+    if (labels.size() + length > UINT32_MAX)
+        throw length_error("trie_arena: label pool doesn't fit into 32-bit offsets");
+    auto offset = (uint32_t)labels.size();
+    labels.insert(labels.end(), bytes, bytes + length);
+    return offset;
+}
+
+size_t trie_arena::compact_labels(node_ref root) {
+    vector<char> compacted;
+    // a node of a minimized trie can be reached more than once
+    unordered_set<node_ref> seen;
+    vector<node_ref> pending = {root};
+    while (!pending.empty()) {
+        node_ref ref = pending.back();
+        pending.pop_back();
+        if (!seen.insert(ref).second)
+            continue;
+
+        trie_node *node = get(ref);
+        if (node->label_length) {
+            const char *label = labels.data() + node->label_offset;
+            node->label_offset = (uint32_t)compacted.size();
+            compacted.insert(compacted.end(), label, label + node->label_length);
+        }
+        node->for_each_child([&](uint8_t, node_ref child) {
+            pending.push_back(child);
+        });
+    }
+
+    compacted.shrink_to_fit();
+    labels.swap(compacted);
+    return labels.size();
+}
+
+size_t trie_arena::size() const {
+    // without the reserved NO_NODE
+    return nodes4.size() + nodes16.size() + nodes48.size() + nodes256.size() - 1;
+}
+
+size_t trie_arena::memory_usage() const {
+    return nodes4.memory_usage() + nodes16.memory_usage() + nodes48.memory_usage() + nodes256.memory_usage()
+           + labels.capacity();
+}
+
+void trie_arena::clear() {
+    nodes4.clear();
+    nodes16.clear();
+    nodes48.clear();
+    nodes256.clear();
+    labels.clear();
+    nodes4.allocate();
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "trie_node.h"
+
+/// Nodes of one layout allocated in fixed-size chunks that never move, so a node keeps its address
+/// while the pool grows. Released nodes are kept on a free list and handed out again first.
+template <typename N>
+class slab_pool {
+private:
+    /// log2 of the number of nodes per chunk, chunks are about 64 KiB but hold at least 16 nodes
+    static constexpr uint32_t chunk_shift() {
+        uint32_t shift = 4;
+        while ((sizeof(N) << (shift + 1)) <= (1u << 16))
+            shift++;
+        return shift;
+    }
+
+    static constexpr uint32_t CHUNK_SHIFT = chunk_shift(), CHUNK_SIZE = 1u << CHUNK_SHIFT;
+
+    std::vector<std::unique_ptr<N[]>> chunks;
+    uint32_t used = 0; // nodes handed out from the chunks so far
+    std::vector<uint32_t> free;
+
+public:
+    uint32_t allocate() {
+        if (!free.empty()) {
+            uint32_t index = free.back();
+            free.pop_back();
+            *at(index) = N();
+            return index;
+        }
+
+        if (used == chunks.size() * CHUNK_SIZE)
+            chunks.emplace_back(new N[CHUNK_SIZE]());
+        return used++;
+    }
+
+    void release(uint32_t index) {
+        free.push_back(index);
+    }
+
+    /// takes over the chunks of the other pool, which is left empty; the unused rest of the last chunk
+    /// of this pool goes to the free list
+    /// \return what is added to the indices of the other pool's nodes
+    uint32_t absorb(slab_pool &other) {
+        auto offset = (uint32_t)capacity();
+        for (uint32_t index = used; index < offset; ++index)
+            free.push_back(index);
+        for (auto &chunk: other.chunks)
+            chunks.push_back(std::move(chunk));
+        for (uint32_t index: other.free)
+            free.push_back(offset + index);
+        used = offset + other.used;
+        other.clear();
+        return offset;
+    }
+
+    [[nodiscard]] N *at(uint32_t index) const {
+        return &chunks[index >> CHUNK_SHIFT][index & (CHUNK_SIZE - 1)];
+    }
+
+    /// number of nodes in use
+    [[nodiscard]] size_t size() const {
+        return used - free.size();
+    }
+
+    /// number of nodes the chunks can hold
+    [[nodiscard]] size_t capacity() const {
+        return chunks.size() * CHUNK_SIZE;
+    }
+
+    /// bytes held by the chunks and the free list
+    [[nodiscard]] size_t memory_usage() const {
+        return chunks.size() * CHUNK_SIZE * sizeof(N) + free.capacity() * sizeof(uint32_t);
+    }
+
+    /// drops every node at once
+    void clear() {
+        chunks.clear();
+        free.clear();
+        used = 0;
+    }
+};
+
+/// Owner of all nodes of a trie. Nodes of each layout come from their own slab pool and are referred
+/// to by 32-bit node_ref values: the layout in the top 2 bits and the index in its pool below.
+/// Nodes are trivially destructible, so the whole trie is released by dropping the chunks,
+/// without walking it.
+class trie_arena {
+private:
+    static constexpr uint32_t KIND_SHIFT = 30;
+
+    slab_pool<trie_node4> nodes4;
+    slab_pool<trie_node16> nodes16;
+    slab_pool<trie_node48> nodes48;
+    slab_pool<trie_node256> nodes256;
+    std::vector<char> labels; // edge labels of path-compressed nodes, a split edge keeps using its bytes
+
+public:
+    static constexpr node_ref NO_NODE = 0;
+    static constexpr uint32_t MAX_INDEX = (1u << KIND_SHIFT) - 1;
+
+    /// reserves the first Node4 as NO_NODE
+    trie_arena();
+
+    trie_arena(const trie_arena &) = delete;
+
+    trie_arena &operator=(const trie_arena &) = delete;
+
+    trie_arena(trie_arena &&) = default;
+
+    trie_arena &operator=(trie_arena &&) = default;
+
+    /// new empty node of the given layout
+    node_ref allocate(trie_node::kind kind);
+
+    /// new node of the same layout with the same content, the node may be in another arena;
+    /// the label offset and the child references are copied as they are
+    node_ref copy(const trie_node *node);
+
+    /// returns the node to the free list of its layout, its children are not touched
+    void release(node_ref ref);
+
+    [[nodiscard]] trie_node *get(node_ref ref) const;
+
+    /// moves the nodes and labels of the other arena into this one without copying them, the other
+    /// arena is left empty; the child references and labels of every node below the root are rebased
+    /// \return reference to the root in this arena
+    node_ref absorb(trie_arena &other, node_ref root);
+
+    static trie_node::kind kind_of(node_ref ref) {
+        return (trie_node::kind)(ref >> KIND_SHIFT);
+    }
+
+    /// appends bytes to the label pool
+    /// \return offset of the first of them
+    uint32_t add_label(const char *bytes, size_t length);
+
+    [[nodiscard]] const char *label(const trie_node *node) const {
+        return labels.data() + node->label_offset;
+    }
+
+    /// bytes in the label pool, the ones no node uses anymore included
+    [[nodiscard]] size_t label_size() const {
+        return labels.size();
+    }
+
+    /// rewrites the label pool with only the labels of the nodes below the root
+    /// \return bytes left in the pool
+    size_t compact_labels(node_ref root);
+
+    /// number of live nodes
+    [[nodiscard]] size_t size() const;
+
+    [[nodiscard]] size_t memory_usage() const;
+
+    /// releases every node at once
+    void clear();
+};
@@ -1,10 +1,221 @@
 #include "trie_node.h"
+#include "trie_arena.h"
 
-trie_node::trie_node() {
-    is_word = false;
+#include <algorithm>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace {
+    /// position of the byte among the first count sorted keys or count if it isn't there
+    int find_key(const uint8_t *keys, int count, uint8_t byte) {
+        for (int i = 0; i < count; ++i)
+            if (keys[i] == byte)
+                return i;
+        return count;
+    }
+
+    int find_key16(const uint8_t *keys, int count, uint8_t byte) {
+#ifdef __SSE2__
+        // all 16 keys are compared at once, bits of the unused keys are masked out
+        __m128i matches = _mm_cmpeq_epi8(_mm_set1_epi8((char)byte),
+                                         _mm_loadu_si128(reinterpret_cast<const __m128i *>(keys)));
+        int mask = _mm_movemask_epi8(matches) & ((1 << count) - 1);
+        return mask ? __builtin_ctz(mask) : count;
+#else
+        return find_key(keys, count, byte);
+#endif
+    }
+
+    /// moves everything but the children to a node of a larger layout
+    void copy_header(const trie_node *from, trie_node *to) {
+        trie_node::kind type = to->type;
+        static_cast<trie_node &>(*to) = *from;
+        to->type = type;
+    }
+
+    // a node shrinks into the next smaller layout at this many children, a few below its capacity,
+    // so a node at the boundary doesn't change its layout on every insert and erase
+    const int SHRINK16 = 3, SHRINK48 = 12, SHRINK256 = 37;
+
+    /// inserts the key and the child into sorted arrays of count elements with room for one more
+    /// \return slot of the child
+    node_ref *insert_sorted(uint8_t *keys, node_ref *children, int count, uint8_t byte, node_ref child) {
+        int position = std::upper_bound(keys, keys + count, byte) - keys;
+        std::copy_backward(keys + position, keys + count, keys + count + 1);
+        std::copy_backward(children + position, children + count, children + count + 1);
+        keys[position] = byte;
+        children[position] = child;
+        return children + position;
+    }
+}
+
+node_ref trie_node::find_child(uint8_t byte) const {
+    node_ref *slot = const_cast<trie_node *>(this)->find_child_slot(byte);
+    return slot ? *slot : trie_arena::NO_NODE;
+}
+
+node_ref *trie_node::find_child_slot(uint8_t byte) {
+    switch (type) {
+        case kind::node4: {
+            auto node = static_cast<trie_node4 *>(this);
+            int i = find_key(node->keys, count, byte);
+            return i < count ? node->children + i : nullptr;
+        }
+        case kind::node16: {
+            auto node = static_cast<trie_node16 *>(this);
+            int i = find_key16(node->keys, count, byte);
+            return i < count ? node->children + i : nullptr;
+        }
+        case kind::node48: {
+            auto node = static_cast<trie_node48 *>(this);
+            return node->index[byte] ? node->children + node->index[byte] - 1 : nullptr;
+        }
+        case kind::node256: {
+            auto node = static_cast<trie_node256 *>(this);
+            return node->children[byte] != trie_arena::NO_NODE ? node->children + byte : nullptr;
+        }
+    }
+    return nullptr;
 }
 
-trie_node::~trie_node() {
-    for (auto &el: children)
-        delete el.second;
-}
\ No newline at end of file
+node_ref *trie_node::add_child(trie_arena &arena, node_ref &node, uint8_t byte, node_ref child) {
+    trie_node *cur = arena.get(node);
+    switch (cur->type) {
+        case kind::node4: {
+            auto old = static_cast<trie_node4 *>(cur);
+            if (old->count < 4)
+                return insert_sorted(old->keys, old->children, old->count++, byte, child);
+
+            node_ref grown_ref = arena.allocate(kind::node16);
+            auto grown = static_cast<trie_node16 *>(arena.get(grown_ref));
+            std::copy(old->keys, old->keys + 4, grown->keys);
+            std::copy(old->children, old->children + 4, grown->children);
+            copy_header(old, grown);
+            arena.release(node);
+            node = grown_ref;
+            return add_child(arena, node, byte, child);
+        }
+        case kind::node16: {
+            auto old = static_cast<trie_node16 *>(cur);
+            if (old->count < 16)
+                return insert_sorted(old->keys, old->children, old->count++, byte, child);
+
+            node_ref grown_ref = arena.allocate(kind::node48);
+            auto grown = static_cast<trie_node48 *>(arena.get(grown_ref));
+            for (int i = 0; i < 16; ++i) {
+                grown->index[old->keys[i]] = i + 1;
+                grown->children[i] = old->children[i];
+            }
+            copy_header(old, grown);
+            arena.release(node);
+            node = grown_ref;
+            return add_child(arena, node, byte, child);
+        }
+        case kind::node48: {
+            auto old = static_cast<trie_node48 *>(cur);
+            if (old->count < 48) {
+                int slot = std::find(old->children, old->children + 48, trie_arena::NO_NODE) - old->children;
+                old->index[byte] = slot + 1;
+                old->children[slot] = child;
+                old->count++;
+                return old->children + slot;
+            }
+
+            node_ref grown_ref = arena.allocate(kind::node256);
+            auto grown = static_cast<trie_node256 *>(arena.get(grown_ref));
+            for (int b = 0; b < 256; ++b)
+                if (old->index[b])
+                    grown->children[b] = old->children[old->index[b] - 1];
+            copy_header(old, grown);
+            arena.release(node);
+            node = grown_ref;
+            return add_child(arena, node, byte, child);
+        }
+        case kind::node256: {
+            auto old = static_cast<trie_node256 *>(cur);
+            old->children[byte] = child;
+            old->count++;
+            return old->children + byte;
+        }
+    }
+    return nullptr;
+}
+
+void trie_node::remove_child(trie_arena &arena, node_ref &node, uint8_t byte) {
+    trie_node *cur = arena.get(node);
+    switch (cur->type) {
+        case kind::node4: {
+            auto old = static_cast<trie_node4 *>(cur);
+            int i = find_key(old->keys, old->count, byte);
+            std::copy(old->keys + i + 1, old->keys + old->count, old->keys + i);
+            std::copy(old->children + i + 1, old->children + old->count, old->children + i);
+            old->count--;
+            old->keys[old->count] = 0;
+            old->children[old->count] = trie_arena::NO_NODE;
+            break;
+        }
+        case kind::node16: {
+            auto old = static_cast<trie_node16 *>(cur);
+            int i = find_key16(old->keys, old->count, byte);
+            std::copy(old->keys + i + 1, old->keys + old->count, old->keys + i);
+            std::copy(old->children + i + 1, old->children + old->count, old->children + i);
+            old->count--;
+            old->keys[old->count] = 0;
+            old->children[old->count] = trie_arena::NO_NODE;
+            if (old->count > SHRINK16)
+                break;
+
+            node_ref shrunk_ref = arena.allocate(kind::node4);
+            auto shrunk = static_cast<trie_node4 *>(arena.get(shrunk_ref));
+            std::copy(old->keys, old->keys + old->count, shrunk->keys);
+            std::copy(old->children, old->children + old->count, shrunk->children);
+            copy_header(old, shrunk);
+            arena.release(node);
+            node = shrunk_ref;
+            break;
+        }
+        case kind::node48: {
+            auto old = static_cast<trie_node48 *>(cur);
+            old->children[old->index[byte] - 1] = trie_arena::NO_NODE;
+            old->index[byte] = 0;
+            old->count--;
+            if (old->count > SHRINK48)
+                break;
+
+            node_ref shrunk_ref = arena.allocate(kind::node16);
+            auto shrunk = static_cast<trie_node16 *>(arena.get(shrunk_ref));
+            int i = 0;
+            for (int b = 0; b < 256; ++b)
+                if (old->index[b]) {
+                    shrunk->keys[i] = (uint8_t)b;
+                    shrunk->children[i++] = old->children[old->index[b] - 1];
+                }
+            copy_header(old, shrunk);
+            arena.release(node);
+            node = shrunk_ref;
+            break;
+        }
+        case kind::node256: {
+            auto old = static_cast<trie_node256 *>(cur);
+            old->children[byte] = trie_arena::NO_NODE;
+            old->count--;
+            if (old->count > SHRINK256)
+                break;
+
+            node_ref shrunk_ref = arena.allocate(kind::node48);
+            auto shrunk = static_cast<trie_node48 *>(arena.get(shrunk_ref));
+            int i = 0;
+            for (int b = 0; b < 256; ++b)
+                if (old->children[b]) {
+                    shrunk->index[b] = i + 1;
+                    shrunk->children[i++] = old->children[b];
+                }
+            copy_header(old, shrunk);
+            arena.release(node);
+            node = shrunk_ref;
+            break;
+        }
+    }
+}
@@ -1,10 +1,113 @@
-#include <unordered_map>
+#pragma once
 
+#include <cstdint>
+
+class trie_arena;
+
+/// reference to a node in a trie_arena, 0 - no node
+using node_ref = uint32_t;
+
+/// Node of the trie. Children are kept in one of four layouts chosen by the fanout, as in an adaptive
+/// radix tree: up to 4 and up to 16 children store sorted key bytes next to the child references,
+/// up to 48 use a 256-entry byte index into 48 child slots, more use a direct 256-entry table.
+/// A node grows into the next layout when it is full, every lookup is a single probe.
 struct trie_node {
-    std::unordered_map<char, trie_node*> children;
-    bool is_word;
+    enum class kind : uint8_t {
+        node4, node16, node48, node256
+    };
+
+    kind type;
+    bool is_word = false;
+    uint16_t count = 0; // number of children
+    // bytes of the edge that follow the key byte leading to the node, in the label pool of the arena;
+    // always empty unless the trie is path-compressed
+    uint32_t label_offset = 0, label_length = 0;
+    uint32_t weight = 0; // weight of the word ending here
+    uint32_t max_weight = 0; // maximal weight of the words in the subtree, the node's own included
+
+    /// child reached by the byte or 0
+    [[nodiscard]] node_ref find_child(uint8_t byte) const;
+
+    /// slot holding the child reached by the byte or nullptr if there is no such child
+    node_ref *find_child_slot(uint8_t byte);
+
+    /// calls f(byte, child) for every child in the order of the bytes
+    template <typename F>
+    void for_each_child(F f) const;
+
+    /// adds a child for a byte that has none yet, a full node is replaced by a larger one
+    /// \param arena arena owning the node
+    /// \param node node to add to, receives the replacement when the node grows
+    /// \return slot holding the new child, it stays valid until the node changes again
+    static node_ref *add_child(trie_arena &arena, node_ref &node, uint8_t byte, node_ref child);
+
+    /// removes the child of a byte, a node that has become sparse enough is replaced by a smaller one;
+    /// the child itself is not released
+    /// \param arena arena owning the node
+    /// \param node node to remove from, receives the replacement when the node shrinks
+    static void remove_child(trie_arena &arena, node_ref &node, uint8_t byte);
+
+protected:
+    explicit trie_node(kind type) : type(type) {}
+};
+
+struct trie_node4 : trie_node {
+    uint8_t keys[4] = {};
+    node_ref children[4] = {};
+
+    trie_node4() : trie_node(kind::node4) {}
+};
+
+struct trie_node16 : trie_node {
+    uint8_t keys[16] = {};
+    node_ref children[16] = {};
+
+    trie_node16() : trie_node(kind::node16) {}
+};
+
+struct trie_node48 : trie_node {
+    uint8_t index[256] = {}; // slot of the child plus one, 0 - no child
+    node_ref children[48] = {};
+
+    trie_node48() : trie_node(kind::node48) {}
+};
+
+struct trie_node256 : trie_node {
+    node_ref children[256] = {};
+
+    trie_node256() : trie_node(kind::node256) {}
+};
 
-    trie_node();
+static_assert(sizeof(trie_node4) == 40, "Node4 must stay 40 bytes");
 
-    virtual ~trie_node();
-};
\ No newline at end of file
+template <typename F>
+void trie_node::for_each_child(F f) const {
+    switch (type) {
+        case kind::node4: {
+            auto node = static_cast<const trie_node4 *>(this);
+            for (int i = 0; i < count; ++i)
+                f(node->keys[i], node->children[i]);
+            break;
+        }
+        case kind::node16: {
+            auto node = static_cast<const trie_node16 *>(this);
+            for (int i = 0; i < count; ++i)
+                f(node->keys[i], node->children[i]);
+            break;
+        }
+        case kind::node48: {
+            auto node = static_cast<const trie_node48 *>(this);
+            for (int b = 0; b < 256; ++b)
+                if (node->index[b])
+                    f((uint8_t)b, node->children[node->index[b] - 1]);
+            break;
+        }
+        case kind::node256: {
+            auto node = static_cast<const trie_node256 *>(this);
+            for (int b = 0; b < 256; ++b)
+                if (node->children[b])
+                    f((uint8_t)b, node->children[b]);
+            break;
+        }
+    }
+}